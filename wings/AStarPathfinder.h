@@ -87,7 +87,8 @@ namespace AStar
 
 		// A* finds a path from start to goal.
 		// h is the heuristic function. h(n) estimates the cost to reach goal from node n.
-		std::vector<glm::ivec2> findPath(const glm::ivec2& start, const glm::ivec2& goal, std::function<bool(const glm::ivec2&)> invalid)
+		// blocked, if given, can rule out the step between two valid neighbours
+		std::vector<glm::ivec2> findPath(const glm::ivec2& start, const glm::ivec2& goal, std::function<bool(const glm::ivec2&)> invalid, std::function<bool(const glm::ivec2&, const glm::ivec2&)> blocked = nullptr)
 		{
 			openSet.push_back(new Node(start, 0, heuristic(start, goal)));
 			nodes[start].reset(openSet[0]);
@@ -123,7 +124,7 @@ namespace AStar
 				for (unsigned int i = 0; i < directions; i++)
 				{
 					glm::ivec2 newPos(current->pos + direction[i]);
-					if (invalid(newPos)) { continue; }
+					if (invalid(newPos) || (blocked && blocked(current->pos, newPos))) { continue; }
 					Node* neighbor = nodes[newPos].get();
 					if (neighbor == 0)
 					{
@@ -0,0 +1,53 @@
+#include <vector>
+#include <algorithm>
+
+#include "ChunkEventBus.h"
+
+struct ChunkEventListeners
+{
+	std::vector<IChunkEventListener*> mListeners;
+	int mPublishing = 0; // nesting depth, listeners are only removed from the list outside of it
+	bool mRemoved = false;
+	int mPublishedCount = 0;
+};
+
+ChunkEventListeners chunkEventListeners[CHUNK_EVENT_COUNT];
+
+void ChunkEventBus::subscribe(ChunkEvent event, IChunkEventListener* listener) { chunkEventListeners[(int)event].mListeners.push_back(listener); }
+
+void ChunkEventBus::unsubscribe(ChunkEvent event, IChunkEventListener* listener)
+{
+	ChunkEventListeners& listeners = chunkEventListeners[(int)event];
+	auto it = std::find(listeners.mListeners.begin(), listeners.mListeners.end(), listener);
+	if (it == listeners.mListeners.end()) { return; }
+
+	// publish may be walking the list, leave a gap until it is done
+	if (listeners.mPublishing > 0)
+	{
+		*it = 0;
+		listeners.mRemoved = true;
+	}
+	else { listeners.mListeners.erase(it); }
+}
+
+void ChunkEventBus::publish(ChunkEvent event, const glm::ivec3& pos, VolumeChunk* chunk)
+{
+	ChunkEventListeners& listeners = chunkEventListeners[(int)event];
+	listeners.mPublishedCount++;
+
+	// by index, listeners subscribing meanwhile may grow the list
+	listeners.mPublishing++;
+	for (size_t i = 0; i < listeners.mListeners.size(); i++)
+	{
+		if (listeners.mListeners[i]) { listeners.mListeners[i]->onChunkEvent(event, pos, chunk); }
+	}
+	listeners.mPublishing--;
+
+	if (listeners.mPublishing == 0 && listeners.mRemoved)
+	{
+		listeners.mListeners.erase(std::remove(listeners.mListeners.begin(), listeners.mListeners.end(), (IChunkEventListener*)0), listeners.mListeners.end());
+		listeners.mRemoved = false;
+	}
+}
+
+int ChunkEventBus::getPublishedCount(ChunkEvent event) { return chunkEventListeners[(int)event].mPublishedCount; }
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+struct VolumeChunk;
+
+// things that happen to a chunk over its lifetime
+enum class ChunkEvent
+{
+	CREATED, // added to the world, the volume may still be empty
+	GENERATED, // terrain (and anything decorating it) was installed
+	MESHED, // a new mesh was uploaded
+	ENTERED_RANGE, // came within render range of the player
+	LEFT_RANGE, // went out of render range
+	EDITED, // changed by the player
+	EVICTED // about to be removed from the world
+};
+
+const int CHUNK_EVENT_COUNT = 7;
+
+class IChunkEventListener
+{
+public:
+	virtual void onChunkEvent(ChunkEvent event, const glm::ivec3& pos, VolumeChunk* chunk) = 0;
+};
+
+// hands chunk events to whoever subscribed to them, so systems that care about a chunk hear about it instead of
+// polling every chunk each frame. main thread only
+class ChunkEventBus
+{
+private:
+	ChunkEventBus() {}
+
+public:
+	static void subscribe(ChunkEvent event, IChunkEventListener* listener);
+	// safe to call from within a listener
+	static void unsubscribe(ChunkEvent event, IChunkEventListener* listener);
+
+	// listeners are called in the order they subscribed. they may publish events themselves
+	static void publish(ChunkEvent event, const glm::ivec3& pos, VolumeChunk* chunk);
+
+	static int getPublishedCount(ChunkEvent event); // since startup
+};
\ No newline at end of file
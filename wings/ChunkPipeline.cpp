@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <thread>
+
+#include "ChunkPipeline.h"
+
+ChunkPipeline::ChunkPipeline(const WorkerStage& workerStage, const ApplyStage& applyStage, const PriorityScore& priorityScore, int maxRunningJobs) :
+	mWorkerStage(workerStage), mApplyStage(applyStage), mPriorityScore(priorityScore), mRunningJobs(0), mMaxRunningJobs(maxRunningJobs), mStub(glm::ivec3(), ChunkStage::REQUESTED), mResultHead(&mStub), mResultTail(&mStub)
+{
+	if (mMaxRunningJobs <= 0) { mMaxRunningJobs = std::max(1, JobSystem::getWorkerCount() * 2); }
+}
+
+ChunkPipeline::~ChunkPipeline()
+{
+	// queued stages still reference the pipeline
+	while (mRunningJobs > 0) { std::this_thread::yield(); }
+
+	for (auto& waiting : mWaiting) { delete waiting.mWork; }
+	for (auto work : mDeferred) { delete work; }
+	while (ChunkWork* work = popResult()) { delete work; }
+}
+
+void ChunkPipeline::dispatch()
+{
+	while (!mWaiting.empty() && mRunningJobs < mMaxRunningJobs)
+	{
+		std::pop_heap(mWaiting.begin(), mWaiting.end());
+		ChunkWork* work = mWaiting.back().mWork;
+		mWaiting.pop_back();
+		schedule(work);
+	}
+}
+
+void ChunkPipeline::schedule(ChunkWork* work)
+{
+	mRunningJobs++;
+	JobSystem::submit([this, work]()
+	{
+		mWorkerStage(work);
+		pushResult(work);
+		mRunningJobs--;
+	}, work->mPriority);
+}
+
+void ChunkPipeline::pushResult(ChunkWork* work)
+{
+	work->mNext.store(0, std::memory_order_relaxed);
+	ChunkWork* prev = mResultHead.exchange(work, std::memory_order_acq_rel);
+	prev->mNext.store(work, std::memory_order_release);
+}
+
+ChunkWork* ChunkPipeline::popResult()
+{
+	ChunkWork* tail = mResultTail;
+	ChunkWork* next = tail->mNext.load(std::memory_order_acquire);
+
+	// skip over the stub
+	if (tail == &mStub)
+	{
+		if (next == 0) { return 0; }
+		mResultTail = next;
+		tail = next;
+		next = next->mNext.load(std::memory_order_acquire);
+	}
+
+	if (next != 0)
+	{
+		mResultTail = next;
+		return tail;
+	}
+
+	// tail is the last item unless a push is halfway done, in which case it shows up on a later call
+	if (tail != mResultHead.load(std::memory_order_acquire)) { return 0; }
+
+	// put the stub back behind the last item so it can be taken off
+	pushResult(&mStub);
+	next = tail->mNext.load(std::memory_order_acquire);
+	if (next != 0)
+	{
+		mResultTail = next;
+		return tail;
+	}
+	return 0;
+}
+
+bool ChunkPipeline::submit(ChunkWork* work)
+{
+	if (!mPending.insert(work->mPosition).second) { delete work; return false; }
+
+	WaitingWork waiting;
+	waiting.mScore = mPriorityScore(work);
+	waiting.mWork = work;
+	mWaiting.push_back(waiting);
+	std::push_heap(mWaiting.begin(), mWaiting.end());
+
+	dispatch();
+	return true;
+}
+
+void ChunkPipeline::reprioritize()
+{
+	for (auto& waiting : mWaiting) { waiting.mScore = mPriorityScore(waiting.mWork); }
+	std::make_heap(mWaiting.begin(), mWaiting.end());
+}
+
+void ChunkPipeline::cancel(const CancelFilter& filter)
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < mWaiting.size(); i++)
+	{
+		ChunkWork* work = mWaiting[i].mWork;
+		if (filter(work))
+		{
+			mPending.erase(work->mPosition);
+			delete work;
+			mCancelledCount++;
+		}
+		else { mWaiting[kept++] = mWaiting[i]; }
+	}
+	if (kept == mWaiting.size()) { return; }
+
+	mWaiting.resize(kept);
+	std::make_heap(mWaiting.begin(), mWaiting.end());
+}
+
+void ChunkPipeline::apply(ChunkWork* work)
+{
+	ChunkApplyResult result = mApplyStage(work);
+	if (result == ChunkApplyResult::DEFERRED) { mDeferred.push_back(work); return; }
+
+	mAppliedCount++;
+	if (result == ChunkApplyResult::CONTINUE) { schedule(work); }
+	else
+	{
+		mPending.erase(work->mPosition);
+		delete work;
+	}
+}
+
+void ChunkPipeline::update(float budgetMillis)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto elapsedMillis = [start]() { return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+
+	mAppliedCount = 0;
+	dispatch();
+
+	// work deferred last update goes first, anything deferred again waits for the next one
+	std::vector<ChunkWork*> deferred;
+	deferred.swap(mDeferred);
+	size_t i = 0;
+	for (; i < deferred.size() && (i == 0 || elapsedMillis() < budgetMillis); i++) { apply(deferred[i]); }
+	mDeferred.insert(mDeferred.end(), deferred.begin() + i, deferred.end());
+
+	while (mAppliedCount == 0 || elapsedMillis() < budgetMillis)
+	{
+		ChunkWork* work = popResult();
+		if (work == 0) { break; }
+		apply(work);
+	}
+
+	// stages that finished made room for waiting work
+	dispatch();
+	mApplyMillis = elapsedMillis();
+}
+
+void ChunkPipeline::finish()
+{
+	while (!mPending.empty())
+	{
+		update(std::numeric_limits<float>::max());
+		if (mPending.empty()) { break; }
+
+		// deferred work may be waiting on a main thread job
+		JobSystem::runMainThreadJobs();
+		std::this_thread::yield();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <unordered_set>
+#include <atomic>
+
+#include <glm/vec3.hpp>
+
+#include "VecUtil.h"
+#include "JobSystem.h"
+
+// the states a chunk passes through before it can be drawn
+enum class ChunkStage
+{
+	REQUESTED, // waiting for terrain generation
+	GENERATED, // terrain is in a private volume, waiting for decoration (trees, structures)
+	DECORATED, // waiting to be installed in the world and meshed
+	MESHED, // mesh is built, waiting for the main thread to upload it
+	UPLOADED
+};
+
+// what the main thread did with a finished stage
+enum class ChunkApplyResult
+{
+	CONTINUE, // send it back to the workers for its next stage
+	FINISHED, // the chunk went all the way through, the work is deleted
+	DEFERRED // can't be applied yet, it is retried on the next update
+};
+
+// a chunk travelling through the pipeline, the game derives from this to carry its stage results
+struct ChunkWork
+{
+	glm::ivec3 mPosition;
+	ChunkStage mStage;
+	JobPriority mPriority = JobPriority::NORMAL;
+	std::atomic<ChunkWork*> mNext;
+
+	ChunkWork(const glm::ivec3& position, ChunkStage stage) : mPosition(position), mStage(stage), mNext(0) {}
+	virtual ~ChunkWork() {}
+};
+
+// moves chunks through their stages. job system workers run the expensive part of each stage on data only they touch,
+// the main thread then applies finished stages to the world within a per frame time budget.
+// submitted work waits in a queue ordered by priority score and only a few jobs run at once, so the most urgent chunk
+// is always the next one started. only one piece of work per chunk position is in the pipeline at a time
+class ChunkPipeline
+{
+public:
+	// runs on a worker thread, does the work of the current stage and advances mStage
+	typedef std::function<void(ChunkWork* work)> WorkerStage;
+	// runs on the main thread for every stage the workers finished
+	typedef std::function<ChunkApplyResult(ChunkWork* work)> ApplyStage;
+	// lower scores start first
+	typedef std::function<float(const ChunkWork* work)> PriorityScore;
+	// decides if waiting work is dropped, called on the main thread
+	typedef std::function<bool(ChunkWork* work)> CancelFilter;
+
+private:
+	struct WaitingWork
+	{
+		float mScore;
+		ChunkWork* mWork;
+
+		bool operator < (const WaitingWork& other) const { return mScore > other.mScore; } // heap top is the lowest score
+	};
+
+	WorkerStage mWorkerStage;
+	ApplyStage mApplyStage;
+	PriorityScore mPriorityScore;
+
+	std::atomic<int> mRunningJobs;
+	int mMaxRunningJobs;
+
+	// finished stages come back through a lock free multi producer single consumer queue, so workers never wait on the
+	// main thread. the queue is intrusive (linked through ChunkWork::mNext) and always holds at least the stub
+	ChunkWork mStub;
+	std::atomic<ChunkWork*> mResultHead;
+	ChunkWork* mResultTail;
+
+	// everything below is main thread only
+	std::vector<WaitingWork> mWaiting;
+	std::vector<ChunkWork*> mDeferred;
+	std::unordered_set<glm::ivec3, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> mPending;
+	int mAppliedCount = 0;
+	int mCancelledCount = 0;
+	float mApplyMillis = 0.0f;
+
+	void dispatch();
+	void schedule(ChunkWork* work);
+	void pushResult(ChunkWork* work);
+	ChunkWork* popResult();
+	void apply(ChunkWork* work);
+
+public:
+	// maxRunningJobs <= 0 allows two jobs per job system worker
+	ChunkPipeline(const WorkerStage& workerStage, const ApplyStage& applyStage, const PriorityScore& priorityScore, int maxRunningJobs = 0);
+	~ChunkPipeline();
+
+	// takes ownership of the work and queues its current stage, returns false (and deletes it) if that chunk is
+	// already in the pipeline
+	bool submit(ChunkWork* work);
+
+	// scores all waiting work again, for when whatever the scores depend on changed
+	void reprioritize();
+
+	// drops waiting work the filter returns true for, work that already started is left to finish
+	void cancel(const CancelFilter& filter);
+
+	bool isPending(const glm::ivec3& pos) const { return mPending.count(pos) != 0; }
+
+	// applies finished stages until the budget is used up, at least one is applied if any are waiting
+	void update(float budgetMillis);
+
+	// blocks until everything submitted so far has gone all the way through
+	void finish();
+
+	int getPendingCount() const { return (int)mPending.size(); }
+	int getWaitingCount() const { return (int)mWaiting.size(); }
+	int getCancelledCount() const { return mCancelledCount; } // since the pipeline was created
+	int getAppliedCount() const { return mAppliedCount; } // during the last update
+	float getApplyMillis() const { return mApplyMillis; } // time the last update took
+};
\ No newline at end of file
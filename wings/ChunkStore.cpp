@@ -0,0 +1,220 @@
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/types.h>
+#endif
+
+#include "ChunkStore.h"
+
+const unsigned int CHUNK_FILE_MAGIC = 0x4B435357; // "WSCK"
+const unsigned int CHUNK_FILE_VERSION = 1;
+const int RUN_BYTES = 6; // voxel count (2 bytes) and the voxel
+
+FILE* openFile(const std::string& path, const char* mode)
+{
+#ifdef _WIN32
+	FILE* file = 0;
+	return fopen_s(&file, path.c_str(), mode) == 0 ? file : 0;
+#else
+	return fopen(path.c_str(), mode);
+#endif
+}
+
+// stores can outgrow what long offsets reach on some platforms
+int seekFile(FILE* file, long long offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, offset, SEEK_SET);
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+long long getFileSize(FILE* file)
+{
+#ifdef _WIN32
+	_fseeki64(file, 0, SEEK_END);
+	return _ftelli64(file);
+#else
+	fseeko(file, 0, SEEK_END);
+	return (long long)ftello(file);
+#endif
+}
+
+bool truncateFile(FILE* file, long long size)
+{
+	fflush(file);
+#ifdef _WIN32
+	return _chsize_s(_fileno(file), size) == 0;
+#else
+	return ftruncate(fileno(file), (off_t)size) == 0;
+#endif
+}
+
+ChunkStore::ChunkStore(const std::string& path, uint64_t seed, bool create) : mPath(path)
+{
+	mFile = openFile(path, "r+b");
+	if (!mFile && create) { mFile = openFile(path, "w+b"); }
+	if (!mFile)
+	{
+		if (create) { printf("Failed to open chunk store %s!\n", path.c_str()); }
+		return;
+	}
+
+	if (!load(seed))
+	{
+		fclose(mFile);
+		mFile = 0;
+		mIndex.clear();
+		return;
+	}
+	printf("Loaded %d chunks from %s\n", (int)mIndex.size(), path.c_str());
+}
+
+ChunkStore::~ChunkStore()
+{
+	if (mFile) { fclose(mFile); }
+}
+
+bool ChunkStore::load(uint64_t seed)
+{
+	long long size = getFileSize(mFile);
+	FileHeader header;
+	if (size < (long long)sizeof(FileHeader))
+	{
+		// new (or never finished) store
+		header.magic = CHUNK_FILE_MAGIC;
+		header.version = CHUNK_FILE_VERSION;
+		header.seed = seed;
+		seekFile(mFile, 0);
+		if (fwrite(&header, sizeof(header), 1, mFile) != 1) { printf("Failed to write chunk store %s!\n", mPath.c_str()); return false; }
+		fflush(mFile);
+		mEnd = sizeof(FileHeader);
+		return truncateFile(mFile, mEnd);
+	}
+
+	seekFile(mFile, 0);
+	if (fread(&header, sizeof(header), 1, mFile) != 1 || header.magic != CHUNK_FILE_MAGIC || header.version != CHUNK_FILE_VERSION)
+	{
+		printf("%s is not a chunk store!\n", mPath.c_str());
+		return false;
+	}
+	if (header.seed != seed)
+	{
+		printf("Chunk store %s was generated with seed %llu, not %llu\n", mPath.c_str(), (unsigned long long)header.seed, (unsigned long long)seed);
+		return false;
+	}
+
+	// later records of a chunk replace earlier ones. the first record that doesn't fit ends the store
+	long long offset = sizeof(FileHeader);
+	while (offset + (long long)sizeof(RecordHeader) <= size)
+	{
+		RecordHeader record;
+		if (fread(&record, sizeof(record), 1, mFile) != 1) { break; }
+		if (record.size == 0 || record.size % RUN_BYTES != 0 || record.size > CHUNK_VOXELS * RUN_BYTES) { break; }
+
+		long long runs = offset + sizeof(RecordHeader);
+		if (runs + record.size > size) { break; }
+
+		RecordEntry entry;
+		entry.offset = runs;
+		entry.size = record.size;
+		mIndex[glm::ivec3(record.x, record.y, record.z)] = entry;
+		offset = runs + record.size;
+		seekFile(mFile, offset);
+	}
+
+	mEnd = offset;
+	if (offset < size)
+	{
+		printf("Dropping %lld bytes of an interrupted write from %s\n", size - offset, mPath.c_str());
+		truncateFile(mFile, offset);
+	}
+	return true;
+}
+
+bool ChunkStore::contains(const glm::ivec3& pos)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mIndex.count(pos) != 0;
+}
+
+int ChunkStore::getCount()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return (int)mIndex.size();
+}
+
+bool ChunkStore::read(const glm::ivec3& pos, unsigned char* voxels)
+{
+	unsigned char runs[CHUNK_VOXELS * RUN_BYTES];
+	unsigned int size;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (!mFile) { return false; }
+
+		auto it = mIndex.find(pos);
+		if (it == mIndex.end()) { return false; }
+
+		size = it->second.size;
+		seekFile(mFile, it->second.offset);
+		if (fread(runs, 1, size, mFile) != size) { printf("Failed to read chunk [%d, %d, %d] from %s!\n", pos.x, pos.y, pos.z, mPath.c_str()); return false; }
+	}
+
+	int voxel = 0;
+	for (unsigned int i = 0; i < size; i += RUN_BYTES)
+	{
+		int count = runs[i] | (runs[i + 1] << 8);
+		if (voxel + count > CHUNK_VOXELS) { printf("Chunk [%d, %d, %d] in %s is damaged!\n", pos.x, pos.y, pos.z, mPath.c_str()); return false; }
+		for (int n = 0; n < count; n++, voxel++) { std::memcpy(voxels + voxel * 4, runs + i + 2, 4); }
+	}
+	if (voxel != CHUNK_VOXELS) { printf("Chunk [%d, %d, %d] in %s is damaged!\n", pos.x, pos.y, pos.z, mPath.c_str()); return false; }
+	return true;
+}
+
+bool ChunkStore::write(const glm::ivec3& pos, const unsigned char* voxels)
+{
+	// runs are encoded before taking the lock, only the append is serialized
+	std::vector<unsigned char> record(sizeof(RecordHeader));
+	record.reserve(sizeof(RecordHeader) + 256);
+	for (int voxel = 0; voxel < CHUNK_VOXELS;)
+	{
+		int count = 1;
+		while (voxel + count < CHUNK_VOXELS && std::memcmp(voxels + voxel * 4, voxels + (voxel + count) * 4, 4) == 0) { count++; }
+
+		unsigned char run[RUN_BYTES] = { (unsigned char)(count & 0xFF), (unsigned char)(count >> 8) };
+		std::memcpy(run + 2, voxels + voxel * 4, 4);
+		record.insert(record.end(), run, run + RUN_BYTES);
+		voxel += count;
+	}
+
+	RecordHeader header;
+	header.x = pos.x;
+	header.y = pos.y;
+	header.z = pos.z;
+	header.size = (unsigned int)(record.size() - sizeof(RecordHeader));
+	std::memcpy(record.data(), &header, sizeof(header));
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mFile) { return false; }
+
+	seekFile(mFile, mEnd);
+	if (fwrite(record.data(), 1, record.size(), mFile) != record.size()) { printf("Failed to write chunk [%d, %d, %d] to %s!\n", pos.x, pos.y, pos.z, mPath.c_str()); return false; }
+
+	RecordEntry entry;
+	entry.offset = mEnd + sizeof(RecordHeader);
+	entry.size = header.size;
+	mIndex[pos] = entry;
+	mEnd += record.size();
+	return true;
+}
+
+void ChunkStore::flush()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mFile) { fflush(mFile); }
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <mutex>
+#include <unordered_map>
+
+#include <glm/vec3.hpp>
+
+#include "VecUtil.h"
+
+// generated chunks kept on disk, so a pre-generated area never has to be generated again. the file is a header followed
+// by one record per chunk, each holding the chunk's voxels as runs of equal voxels. records are only ever appended and
+// a record cut off by an interrupted run is dropped when the file is opened again, so filling a store can be resumed.
+// thread safe
+class ChunkStore
+{
+public:
+	static const int CHUNK_EDGE = 17; // chunk volumes also hold the first row of their upper neighbours
+	static const int CHUNK_VOXELS = CHUNK_EDGE * CHUNK_EDGE * CHUNK_EDGE;
+	static const int CHUNK_BYTES = CHUNK_VOXELS * 4; // rgba, x first, then y, then z
+
+private:
+	struct FileHeader
+	{
+		unsigned int magic;
+		unsigned int version;
+		uint64_t seed;
+	};
+
+	struct RecordHeader
+	{
+		int x;
+		int y;
+		int z;
+		unsigned int size; // bytes of runs following the header
+	};
+
+	struct RecordEntry
+	{
+		long long offset; // of the runs
+		unsigned int size;
+	};
+
+	std::string mPath;
+	FILE* mFile = 0;
+	long long mEnd = 0;
+	std::mutex mMutex;
+	std::unordered_map<glm::ivec3, RecordEntry, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> mIndex;
+
+	bool load(uint64_t seed);
+
+public:
+	// opens the store, creating it if create is set. a store generated with another seed is left alone and not opened
+	ChunkStore(const std::string& path, uint64_t seed, bool create);
+	~ChunkStore();
+
+	bool isOpen() const { return mFile != 0; }
+	const std::string& getPath() const { return mPath; }
+
+	bool contains(const glm::ivec3& pos);
+	int getCount();
+
+	// fills CHUNK_BYTES of voxels, returns false if the chunk isn't stored
+	bool read(const glm::ivec3& pos, unsigned char* voxels);
+	// appends the chunk, a chunk stored before is replaced
+	bool write(const glm::ivec3& pos, const unsigned char* voxels);
+	// pushes written chunks to the file, anything written since the last flush may be lost when interrupted
+	void flush();
+};
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include <cstring>
+
+#include "DungeonMaze.h"
+#include "Randomizer.h"
+
+const int RANDOM_WALK_MOVES = 300;
+
+void DungeonMaze::closeAll()
+{
+	std::memset(mWalls, 0xFF, sizeof(mWalls));
+	mSpawnTileCount = 0;
+}
+
+glm::ivec2 DungeonMaze::getStep(MazeWall wall)
+{
+	if (wall == MazeWall::FORWARD) { return glm::ivec2(0, 1); }
+	else if (wall == MazeWall::RIGHT) { return glm::ivec2(1, 0); }
+	else if (wall == MazeWall::BACKWARD) { return glm::ivec2(0, -1); }
+	else if (wall == MazeWall::LEFT) { return glm::ivec2(-1, 0); }
+	else { return glm::ivec2(0); }
+}
+
+MazeWall DungeonMaze::getInverse(MazeWall wall)
+{
+	if (wall == MazeWall::FORWARD) { return MazeWall::BACKWARD; }
+	else if (wall == MazeWall::RIGHT) { return MazeWall::LEFT; }
+	else if (wall == MazeWall::BACKWARD) { return MazeWall::FORWARD; }
+	else if (wall == MazeWall::LEFT) { return MazeWall::RIGHT; }
+	else { return MazeWall::INVALID; }
+}
+
+void DungeonMaze::openPassage(int index, MazeWall wall)
+{
+	glm::ivec2 next(getCell(index) + getStep(wall));
+	openWall(index, wall);
+	openWall(getIndex(next.x, next.y), getInverse(wall));
+}
+
+bool DungeonMaze::canStep(const glm::ivec2& from, const glm::ivec2& to) const
+{
+	if (!isInside(from) || !isInside(to)) { return false; }
+
+	glm::ivec2 delta(to - from);
+	MazeWall wall;
+	if (delta == glm::ivec2(0, 1)) { wall = MazeWall::FORWARD; }
+	else if (delta == glm::ivec2(1, 0)) { wall = MazeWall::RIGHT; }
+	else if (delta == glm::ivec2(0, -1)) { wall = MazeWall::BACKWARD; }
+	else if (delta == glm::ivec2(-1, 0)) { wall = MazeWall::LEFT; }
+	else { return false; }
+	return !hasWall(from.x, from.y, wall);
+}
+
+void DungeonMaze::generateRandomWalk(uint64_t seed)
+{
+	RandomStream random(seed);
+	glm::ivec2 pos(random.nextInt(0, SIZE - 1), random.nextInt(0, SIZE - 1));
+	mStart = pos;
+
+	MazeWall lastDirection = MazeWall::INVALID;
+	for (int move = 0; move < RANDOM_WALK_MOVES; move++)
+	{
+		MazeWall direction = (MazeWall)random.nextInt(0, 3);
+		// don't just go forwards and backwards, and don't start a run that leaves the maze right away
+		if (lastDirection != MazeWall::INVALID)
+		{
+			while (direction == getInverse(lastDirection) || !isInside(pos + getStep(direction))) { direction = (MazeWall)random.nextInt(0, 3); }
+		}
+
+		// runs stop at the edge of the maze
+		int length = random.nextInt(2, 8);
+		for (int i = 0; i < length && isInside(pos + getStep(direction)); i++)
+		{
+			openPassage(getIndex(pos.x, pos.y), direction);
+			pos += getStep(direction);
+		}
+		lastDirection = direction;
+	}
+}
+
+void DungeonMaze::generateRecursiveBacktracker(uint64_t seed)
+{
+	RandomStream random(seed);
+	unsigned char visited[CELLS] = {};
+	unsigned short stack[CELLS];
+	int depth = 0;
+
+	int start = random.nextInt(0, CELLS - 1);
+	mStart = getCell(start);
+	visited[start] = 1;
+	stack[depth++] = (unsigned short)start;
+
+	// carve into a random unvisited neighbour, back up once there are none left
+	while (depth > 0)
+	{
+		int index = stack[depth - 1];
+		glm::ivec2 cell(getCell(index));
+
+		MazeWall options[4];
+		int optionCount = 0;
+		for (int wall = 0; wall < 4; wall++)
+		{
+			glm::ivec2 next(cell + getStep((MazeWall)wall));
+			if (isInside(next) && !visited[getIndex(next.x, next.y)]) { options[optionCount++] = (MazeWall)wall; }
+		}
+		if (optionCount == 0) { depth--; continue; }
+
+		MazeWall wall = options[random.nextInt(0, optionCount - 1)];
+		openPassage(index, wall);
+		glm::ivec2 next(cell + getStep(wall));
+		int nextIndex = getIndex(next.x, next.y);
+		visited[nextIndex] = 1;
+		stack[depth++] = (unsigned short)nextIndex;
+	}
+}
+
+void DungeonMaze::generateWilson(uint64_t seed)
+{
+	RandomStream random(seed);
+	unsigned char inMaze[CELLS] = {};
+	unsigned char exits[CELLS]; // side a walk last left the cell through
+
+	int start = random.nextInt(0, CELLS - 1);
+	mStart = getCell(start);
+	inMaze[start] = 1;
+
+	for (int begin = 0; begin < CELLS; begin++)
+	{
+		if (inMaze[begin]) { continue; }
+
+		// walk randomly until the maze is hit. only the last exit of every cell is kept, which erases the loops
+		int index = begin;
+		while (!inMaze[index])
+		{
+			glm::ivec2 cell(getCell(index));
+			MazeWall wall;
+			do { wall = (MazeWall)random.nextInt(0, 3); } while (!isInside(cell + getStep(wall)));
+
+			exits[index] = (unsigned char)wall;
+			glm::ivec2 next(cell + getStep(wall));
+			index = getIndex(next.x, next.y);
+		}
+
+		// then carve what is left of the walk into the maze
+		index = begin;
+		while (!inMaze[index])
+		{
+			MazeWall wall = (MazeWall)exits[index];
+			inMaze[index] = 1;
+			openPassage(index, wall);
+			glm::ivec2 next(getCell(index) + getStep(wall));
+			index = getIndex(next.x, next.y);
+		}
+	}
+}
+
+void DungeonMaze::findSpawnTiles()
+{
+	// breadth first from the start, so tiles come in order of how far they are to walk
+	unsigned short queue[CELLS];
+	unsigned short steps[CELLS];
+	std::memset(steps, 0xFF, sizeof(steps));
+	int head = 0;
+	int tail = 0;
+
+	int start = getIndex(mStart.x, mStart.y);
+	steps[start] = 0;
+	queue[tail++] = (unsigned short)start;
+	mSpawnTileCount = 0;
+
+	while (head < tail)
+	{
+		int index = queue[head++];
+		if (steps[index] >= SPAWN_MIN_STEPS) { mSpawnTiles[mSpawnTileCount++] = (unsigned short)index; }
+
+		glm::ivec2 cell(getCell(index));
+		for (int wall = 0; wall < 4; wall++)
+		{
+			if (getWalls(index) & (1 << wall)) { continue; }
+
+			glm::ivec2 next(cell + getStep((MazeWall)wall));
+			int nextIndex = getIndex(next.x, next.y);
+			if (steps[nextIndex] != 0xFFFF) { continue; }
+
+			steps[nextIndex] = steps[index] + 1;
+			queue[tail++] = (unsigned short)nextIndex;
+		}
+	}
+}
+
+void DungeonMaze::generate(MazeGenerator generator, uint64_t seed)
+{
+	closeAll();
+	if (generator == MazeGenerator::RECURSIVE_BACKTRACKER) { generateRecursiveBacktracker(seed); }
+	else if (generator == MazeGenerator::WILSON) { generateWilson(seed); }
+	else { generateRandomWalk(seed); }
+	findSpawnTiles();
+}
+
+const char* DungeonMaze::getGeneratorName(MazeGenerator generator)
+{
+	if (generator == MazeGenerator::RECURSIVE_BACKTRACKER) { return "backtracker"; }
+	else if (generator == MazeGenerator::WILSON) { return "wilson"; }
+	else { return "walk"; }
+}
\ No newline at end of file
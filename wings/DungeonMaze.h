@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/vec2.hpp>
+
+// sides of a maze cell, forward is +y (+z in the world) and right is +x
+enum class MazeWall
+{
+	FORWARD,
+	RIGHT,
+	BACKWARD,
+	LEFT,
+	INVALID
+};
+
+enum class MazeGenerator
+{
+	RANDOM_WALK, // a few hundred straight runs from a random cell, most cells stay walled in
+	RECURSIVE_BACKTRACKER, // long winding corridors through every cell
+	WILSON // uniformly random spanning tree through every cell, shorter dead ends
+};
+
+const int MAZE_GENERATOR_COUNT = 3;
+
+// the walls of a dungeon's maze, four bits per cell. generating it doesn't allocate and only depends on the seed, so it
+// can run on a worker. the cells and their open sides are also the graph enemies path through, both sides of an open
+// wall always agree
+class DungeonMaze
+{
+public:
+	static const int SIZE = 57;
+	static const int CELLS = SIZE * SIZE;
+	static const int SPAWN_MIN_STEPS = 3; // spawn tiles are at least this many steps from the start
+
+private:
+	unsigned char mWalls[CELLS / 2 + 1]; // low nibble for even cells, high for odd ones, a bit is set per closed side
+	glm::ivec2 mStart;
+	unsigned short mSpawnTiles[CELLS]; // cell indices, see getSpawnTile
+	int mSpawnTileCount = 0;
+
+	static int getIndex(int x, int y) { return x + y * SIZE; }
+	static glm::ivec2 getCell(int index) { return glm::ivec2(index % SIZE, index / SIZE); }
+
+	int getWalls(int index) const { return (mWalls[index >> 1] >> ((index & 1) * 4)) & 0xF; }
+	void openWall(int index, MazeWall wall) { mWalls[index >> 1] &= (unsigned char)~(1 << ((int)wall + (index & 1) * 4)); }
+	// opens the side of the cell and the matching side of its neighbour
+	void openPassage(int index, MazeWall wall);
+
+	void generateRandomWalk(uint64_t seed);
+	void generateRecursiveBacktracker(uint64_t seed);
+	void generateWilson(uint64_t seed);
+	void findSpawnTiles();
+
+public:
+	DungeonMaze() : mStart(0) { closeAll(); }
+
+	void closeAll();
+	// carves a new maze, the same seed and generator always carve the same one
+	void generate(MazeGenerator generator, uint64_t seed);
+
+	static bool isInside(const glm::ivec2& cell) { return cell.x >= 0 && cell.y >= 0 && cell.x < SIZE && cell.y < SIZE; }
+	static glm::ivec2 getStep(MazeWall wall);
+	static MazeWall getInverse(MazeWall wall);
+
+	bool hasWall(int x, int y, MazeWall wall) const { return (getWalls(getIndex(x, y)) & (1 << (int)wall)) != 0; }
+	bool isClosed(int x, int y) const { return getWalls(getIndex(x, y)) == 0xF; } // walled in on all sides
+	// cells enemies can be in
+	bool isWalkable(const glm::ivec2& cell) const { return isInside(cell) && !isClosed(cell.x, cell.y); }
+	// neighbouring cells with no wall between them
+	bool canStep(const glm::ivec2& from, const glm::ivec2& to) const;
+
+	const glm::ivec2& getStart() const { return mStart; }
+	int getSpawnTileCount() const { return mSpawnTileCount; }
+	glm::ivec2 getSpawnTile(int i) const { return getCell(mSpawnTiles[i]); }
+
+	static const char* getGeneratorName(MazeGenerator generator);
+};
\ No newline at end of file
@@ -24,6 +24,9 @@
 #include <iterator>
 #include <deque>
 #include <atomic>
+#include <map>
+#include <array>
+#include <cstring>
 
 #include <glm/vec3.hpp>
 #include <glm/vec2.hpp>
@@ -48,6 +51,21 @@
 #include "UIWindowManager.h"
 #include "ItemDisplayUIWindow.h"
 #include "SkillInformationProvider.h"
+#include "MinimapTileCache.h"
+#include "MinimapTilePyramid.h"
+#include "MinimapPreviewSampler.h"
+#include "RenderQueue.h"
+#include "VoxelFaceRenderer.h"
+#include "ChunkPipeline.h"
+#include "ChunkEventBus.h"
+#include "JobSystem.h"
+#include "StructureStamp.h"
+#include "FeatureGrid.h"
+#include "DungeonMaze.h"
+#include "ChunkStore.h"
+#include "ProcessMemory.h"
+#include "FrameScheduler.h"
+#include "VecUtil.h"
 
 #pragma endregion
 
@@ -196,9 +214,20 @@ public:
 		reset();
 	}
 
+	// copies the voxels, for work that must not see later changes to the original
+	VoxelVolume(const VoxelVolume& other) : mRegion(other.mRegion)
+	{
+		reset();
+		std::memcpy(mData, other.mData, mRegion.getWidth() * mRegion.getHeight() * mRegion.getDepth() * sizeof(VoxelType));
+	}
+
+	VoxelVolume& operator=(const VoxelVolume& other) = delete;
+
+	~VoxelVolume() { delete[] mData; }
+
 	void reset()
 	{
-		if (mData) { delete mData; }
+		if (mData) { delete[] mData; }
 		mData = new VoxelType[mRegion.getWidth() * mRegion.getHeight() * mRegion.getDepth()];
 	}
 
@@ -244,6 +273,16 @@ public:
 		else { return false; }
 	}
 
+	// copies count voxels into the row starting at x, y, z, the whole row has to be inside the volume
+	void setVoxelRun(int x, int y, int z, const StampVoxel* voxels, int count)
+	{
+		static_assert(sizeof(VoxelType) == sizeof(StampVoxel), "stamp voxels are copied as they are");
+		assert(mRegion.containsPoint(glm::ivec3(x, y, z)) && mRegion.containsPoint(glm::ivec3(x + count - 1, y, z)));
+
+		const glm::ivec3& lower = mRegion.getLowerCorner();
+		std::memcpy(&mData[(x - lower.x) + (y - lower.y) * mRegion.getWidth() + (z - lower.z) * mRegion.getWidth() * mRegion.getHeight()], voxels, count * sizeof(VoxelType));
+	}
+
 private:
 	VolumeRegion mRegion;
 	VoxelType* mData = 0;
@@ -362,6 +401,51 @@ void extractVolumeSurface(VoxelVolume* volume, Mesh* mesh)
 	printf("Extracted (%d, %d, %d) with %d indices.\n", region.getLowerCorner().x, region.getLowerCorner().y, region.getLowerCorner().z, mesh->getNumIndices());
 }
 
+// same surface as extractVolumeSurface, packed for VoxelFaceRenderer
+void packVolumeSurface(VoxelVolume* volume, PackedFaceMesh* mesh)
+{
+	const VolumeRegion& region = volume->getEnclosingRegion();
+	std::unordered_map<unsigned int, unsigned int> paletteIndices;
+	std::vector<unsigned int> palette;
+	glm::vec3 material;
+
+	auto addFace = [&](int x, int y, int z, VoxelFace face, const VoxelType& type)
+	{
+		unsigned int color = VoxelFaceRenderer::packColor(type.r, type.g, type.b);
+		auto it = paletteIndices.find(color);
+		if (it == paletteIndices.end())
+		{
+			it = paletteIndices.insert(std::make_pair(color, (unsigned int)palette.size())).first;
+			palette.push_back(color);
+		}
+		mesh->mWords.push_back(VoxelFaceRenderer::packFace(x - region.getLowerCorner().x, y - region.getLowerCorner().y, z - region.getLowerCorner().z, face, it->second));
+	};
+
+	for (int32_t z = region.getLowerCorner().z; z < region.getUpperCorner().z; z++)
+	{
+		for (int32_t y = region.getLowerCorner().y; y < region.getUpperCorner().y; y++)
+		{
+			for (int32_t x = region.getLowerCorner().x; x < region.getUpperCorner().x; x++)
+			{
+				const VoxelType& curVoxel = volume->getVoxelAt(x, y, z);
+				const VoxelType& nextX = volume->getVoxelAt(x + 1, y, z);
+				const VoxelType& nextY = volume->getVoxelAt(x, y + 1, z);
+				const VoxelType& nextZ = volume->getVoxelAt(x, y, z + 1);
+
+				if (isQuadNeeded(curVoxel, nextX, material)) { addFace(x, y, z, FACE_POSITIVE_X, curVoxel); }
+				if (isQuadNeeded(nextX, curVoxel, material)) { addFace(x, y, z, FACE_NEGATIVE_X, nextX); }
+				if (isQuadNeeded(curVoxel, nextY, material)) { addFace(x, y, z, FACE_POSITIVE_Y, curVoxel); }
+				if (isQuadNeeded(nextY, curVoxel, material)) { addFace(x, y, z, FACE_NEGATIVE_Y, nextY); }
+				if (isQuadNeeded(curVoxel, nextZ, material)) { addFace(x, y, z, FACE_POSITIVE_Z, curVoxel); }
+				if (isQuadNeeded(nextZ, curVoxel, material)) { addFace(x, y, z, FACE_NEGATIVE_Z, nextZ); }
+			}
+		}
+	}
+
+	mesh->mFaceCount = (int)mesh->mWords.size();
+	mesh->mWords.insert(mesh->mWords.end(), palette.begin(), palette.end());
+}
+
 class VolumeSampler
 {
 public:
@@ -2385,6 +2469,9 @@ Ray unproject(const glm::ivec2& pos)
 
 void setOrthographicProjection() {
 
+	// draw batched quads with the projection they were queued under
+	Renderer::flush();
+
 	// switch to projection mode
 	glMatrixMode(GL_PROJECTION);
 
@@ -2414,6 +2501,8 @@ void setOrthographicProjection() {
 
 void restorePerspectiveProjection() {
 
+	Renderer::flush();
+
 	glMatrixMode(GL_PROJECTION);
 	// restore previous projection matrix
 	glPopMatrix();
@@ -2432,15 +2521,15 @@ GLUT_STROKE_MONO_ROMAN (fixed width font: 104.76 units wide).
 void renderStrokeFontString(float x, float y, float z, void* font, const char* string) {
 
 	const char* c;
-	glPushMatrix();
-	glTranslatef(x, y, z);
-	glScalef(0.1f, 0.1f, 0.1f);
+	Renderer::pushMatrix();
+	Renderer::translatef(x, y, z);
+	Renderer::scalef(0.1f, 0.1f, 0.1f);
 
 	for (c = string; *c != '\0'; c++) {
 		glutStrokeCharacter(font, *c);
 	}
 
-	glPopMatrix();
+	Renderer::popMatrix();
 }
 
 #pragma endregion
@@ -2534,20 +2623,23 @@ struct VolumeChunk
 	std::unique_ptr<VoxelVolume> mVolume;
 	std::unique_ptr<Mesh> mMesh;
 	bool mMeshNeedsUpdate = false;
-	std::unique_ptr<Mesh> mUpdatedMesh;
-	bool mUpdatingMesh = false;
-	bool mUpdatedMeshReady = false;
+	bool mPlayerEdited = false; // set by the voxel editor until the edit is being meshed
+	std::unique_ptr<PackedFaceMesh> mFaces; // used instead of the mesh when VoxelFaceRenderer is enabled
 
 	void render()
 	{
-		glPushMatrix();
-		glTranslatef((float)mVolume->getEnclosingRegion().getLowerCorner().x, (float)mVolume->getEnclosingRegion().getLowerCorner().y, (float)mVolume->getEnclosingRegion().getLowerCorner().z);
+		Renderer::pushMatrix();
+		Renderer::translatef((float)mVolume->getEnclosingRegion().getLowerCorner().x, (float)mVolume->getEnclosingRegion().getLowerCorner().y, (float)mVolume->getEnclosingRegion().getLowerCorner().z);
 
-		if (mMesh.get() == 0)
+		if (VoxelFaceRenderer::isEnabled())
+		{
+			if (mFaces) { VoxelFaceRenderer::draw(mFaces.get()); }
+		}
+		else if (mMesh.get() == 0)
 		{
-			glTranslatef(8.0f, 8.0f, 8.0f);
-			glColor4f(0.2f, 0.2f, 0.2f, 0.3f);
-			glutSolidCube(16.0f);
+			Renderer::translatef(8.0f, 8.0f, 8.0f);
+			Renderer::color4f(0.2f, 0.2f, 0.2f, 0.3f);
+			Renderer::solidCube(16.0f);
 		}
 		else
 		{
@@ -2555,19 +2647,21 @@ struct VolumeChunk
 			for (size_t i = 0; i < mMesh->getNumIndices(); i++)
 			{
 				const Vertex& vert = mMesh->getRenderVertex(i);
-				glColor3f(vert.mColor.r, vert.mColor.g, vert.mColor.b);
+				Renderer::color3f(vert.mColor.r, vert.mColor.g, vert.mColor.b);
 				glNormal3f(vert.mNormal.x, vert.mNormal.y, vert.mNormal.z);
 				glVertex3f(vert.mPosition.x, vert.mPosition.y, vert.mPosition.z);
 			}
 			glEnd();
 		}
 
-		glPopMatrix();
+		Renderer::popMatrix();
 	}
 
 	long long mLastVisited = 0; // time the chunk was last unloaded by all visitors
 	bool mDungeon = false; // indicates the chunk was generated as part of a dungeon
 	bool mNeedsRegeneration = false; // mark an existing chunk for regeneration using the chunk generation algorithm
+	std::vector<StructurePlacement> mStructures; // copied into the volume so far, see forEachUncoveredSpan
+	int mVisibleIndex = -1; // position in the visible chunk list, -1 while out of range
 	int mOwnerId = 0; // if ownable, the owner's player id. singleplayer defaults to 1
 	long long mOwnershipStartTime = 0; // set to current time when initially claimed
 	long long mOwnershipDuration = 0; // extended upon claims
@@ -2575,50 +2669,178 @@ struct VolumeChunk
 	long long getRemainingOwnershipTime() { return (mOwnershipStartTime + mOwnershipDuration) - Tools::currentTimeMillis(); }
 };
 
-struct ChunkMinimapColormap
+// the top solid voxel of every voxel column of a chunk column and its colour, which is what the minimap shows. which
+// voxels are solid is also kept as a bit per voxel for each chunk of the column, so removing the top voxel finds the
+// next one down by scanning those bits instead of the volumes
+struct ChunkColumnHeightmap
 {
-	int mHighestVoxel = std::numeric_limits<int>::lowest();
+	static const int NO_HEIGHT = std::numeric_limits<int>::lowest();
+
+	int mHeights[16][16];
 	VoxelType mColors[16][16];
+	std::map<int, std::array<unsigned short, 256>> mSolidBits; // by chunk y, bit y - chunk y * 16 of [x * 16 + z]
 	glm::ivec2 mLowerCorner;
 
-	ChunkMinimapColormap(const glm::ivec3& chunkLowerBound) : mLowerCorner(chunkLowerBound.x, chunkLowerBound.z) {}
-
-	const VoxelType& getColorAt(int x, int z)
+	ChunkColumnHeightmap(const glm::ivec2& chunkColumn) : mLowerCorner(chunkColumn * 16)
 	{
-		int localX = x - mLowerCorner.x;
-		int localZ = z - mLowerCorner.y;
-		return mColors[localX][localZ];
+		for (int x = 0; x < 16; x++) { for (int z = 0; z < 16; z++) { mHeights[x][z] = NO_HEIGHT; } }
 	}
 
-	void setColorAt(int x, int y, int z, const VoxelType& val)
+	int getHeightAt(int x, int z) const { return mHeights[x - mLowerCorner.x][z - mLowerCorner.y]; }
+	const VoxelType& getColorAt(int x, int z) const { return mColors[x - mLowerCorner.x][z - mLowerCorner.y]; }
+
+	std::array<unsigned short, 256>& getSolidBits(int chunkY)
 	{
-		if (y < mHighestVoxel) { return; }
+		auto it = mSolidBits.find(chunkY);
+		if (it == mSolidBits.end()) { it = mSolidBits.insert(std::make_pair(chunkY, std::array<unsigned short, 256>())).first; it->second.fill(0); }
+		return it->second;
+	}
 
-		int localX = x - mLowerCorner.x;
-		int localZ = z - mLowerCorner.y;
-		mColors[localX][localZ] = val;
+	// the top solid voxel of a column according to the bits, NO_HEIGHT if there is none
+	int findHeight(int localX, int localZ) const
+	{
+		for (auto it = mSolidBits.rbegin(); it != mSolidBits.rend(); ++it)
+		{
+			unsigned short bits = it->second[localX * 16 + localZ];
+			if (bits == 0) { continue; }
 
-		mHighestVoxel = y;
+			int bit = 15;
+			while ((bits & (1 << bit)) == 0) { bit--; }
+			return it->first * 16 + bit;
+		}
+		return NO_HEIGHT;
 	}
 };
 
-struct KeyHash_GLMIVec3
+std::unordered_map<glm::ivec3, std::unique_ptr<VolumeChunk>, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> mChunks;
+unsigned int chunkWorldGeneration = 0; // goes up whenever mChunks is thrown away, see discardChunkWork
+std::unordered_map<glm::ivec2, std::unique_ptr<ChunkColumnHeightmap>, KeyHash_GLMIVec2, KeyEqual_GLMIVec2> mChunkHeightmaps;
+
+std::unique_ptr<MinimapTilePyramid> minimapPyramid;
+std::unique_ptr<MinimapPreviewSampler> minimapPreview;
+std::unordered_set<glm::ivec2, KeyHash_GLMIVec2, KeyEqual_GLMIVec2> changedMinimapColumns;
+
+bool getMinimapTile(const glm::ivec3& tile, unsigned char* rgba)
+{
+	if (!minimapPyramid) { return false; }
+
+	// anything not fully explored gets a noise prediction in the background
+	unsigned int flags = 0;
+	bool found = minimapPyramid->getTile(tile, rgba, &flags);
+	if (minimapPreview && (!found || (tile.z > 0 && (flags & MinimapTilePyramid::TILE_PREDICTED) == 0))) { minimapPreview->request(tile); }
+	return found;
+}
+
+MinimapTileCache minimapTiles(getMinimapTile);
+
+// hands columns changed since the last call to the tile pyramid and refreshes the tiles it rebuilt. columns that
+// don't fit in the budget are left for the next call
+void updateMinimapPyramid(float budgetMillis)
 {
-	size_t operator()(const glm::ivec3& k) const
+	if (!minimapPyramid) { return; }
+
+	auto start = std::chrono::steady_clock::now();
+	unsigned char rgba[MinimapTilePyramid::TILE_BYTES];
+	for (auto columnIt = changedMinimapColumns.begin(); columnIt != changedMinimapColumns.end() && std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() < budgetMillis; columnIt = changedMinimapColumns.erase(columnIt))
 	{
-		return std::hash<int>()(k.x) ^ std::hash<int>()(k.y) ^ std::hash<int>()(k.z);
+		const glm::ivec2& column = *columnIt;
+		auto it = mChunkHeightmaps.find(column);
+		if (it == mChunkHeightmaps.end()) { continue; }
+
+		for (int z = 0; z < 16; z++)
+		{
+			for (int x = 0; x < 16; x++)
+			{
+				const VoxelType& type = it->second->mColors[x][z];
+				unsigned char* texel = rgba + ((z * 16) + x) * 4;
+				texel[0] = type.r;
+				texel[1] = type.g;
+				texel[2] = type.b;
+				texel[3] = type.a;
+			}
+		}
+		minimapPyramid->submitColumn(column, rgba);
 	}
-};
-struct KeyEqual_GLMIVec3
+
+	std::vector<glm::ivec3> rebuilt;
+	minimapPyramid->takeChangedTiles(rebuilt);
+	for (auto& tile : rebuilt) { minimapTiles.invalidate(tile); }
+}
+
+ChunkColumnHeightmap* getChunkHeightmap(const glm::ivec3& chunkPos)
+{
+	glm::ivec2 column(chunkPos.x, chunkPos.z);
+	auto it = mChunkHeightmaps.find(column);
+	if (it == mChunkHeightmaps.end()) { it = mChunkHeightmaps.insert(std::make_pair(column, std::unique_ptr<ChunkColumnHeightmap>(new ChunkColumnHeightmap(column)))).first; }
+	return it->second.get();
+}
+
+// colour of a voxel in a chunk that was already created, air otherwise
+const VoxelType& getLoadedVoxel(int x, int y, int z)
+{
+	auto it = mChunks.find(glm::ivec3(floorDiv(x, 16), floorDiv(y, 16), floorDiv(z, 16)));
+	if (it == mChunks.end()) { return EmptyVoxelType; }
+	return it->second->mVolume->getVoxelAt(x, y, z);
+}
+
+// keeps the heightmap up to date with a single voxel being set. placing only compares against the current top,
+// removing the top voxel looks for the next one down
+void setHeightmapVoxel(const glm::ivec3& chunkPos, int x, int y, int z, const VoxelType& type)
 {
-	bool operator()(const glm::ivec3& a, const glm::ivec3& b) const
+	ChunkColumnHeightmap* heightmap = getChunkHeightmap(chunkPos);
+	int localX = x - heightmap->mLowerCorner.x;
+	int localZ = z - heightmap->mLowerCorner.y;
+	unsigned short& bits = heightmap->getSolidBits(chunkPos.y)[localX * 16 + localZ];
+	unsigned short bit = (unsigned short)(1 << (y - chunkPos.y * 16));
+	int& height = heightmap->mHeights[localX][localZ];
+
+	if (!type.isAir())
 	{
-		return a.x == b.x && a.y == b.y && a.z == b.z;
+		bits |= bit;
+		if (y < height) { return; }
+		height = y;
+		heightmap->mColors[localX][localZ] = type;
 	}
-};
+	else
+	{
+		bits &= ~bit;
+		if (y != height) { return; }
+		height = heightmap->findHeight(localX, localZ);
+		heightmap->mColors[localX][localZ] = height == ChunkColumnHeightmap::NO_HEIGHT ? EmptyVoxelType : getLoadedVoxel(x, height, z);
+	}
+	changedMinimapColumns.insert(glm::ivec2(chunkPos.x, chunkPos.z));
+}
 
-std::unordered_map<glm::ivec3, std::unique_ptr<VolumeChunk>, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> mChunks;
-std::unordered_map<glm::ivec3, std::unique_ptr<ChunkMinimapColormap>, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> mChunkMinimapColors;
+// rebuilds the part of the heightmap a chunk volume filled outside of setVoxel covers
+void setChunkHeightmap(const glm::ivec3& chunkPos, VoxelVolume* volume)
+{
+	ChunkColumnHeightmap* heightmap = getChunkHeightmap(chunkPos);
+	std::array<unsigned short, 256>& solidBits = heightmap->getSolidBits(chunkPos.y);
+	glm::ivec3 corner(chunkPos * 16);
+	bool changed = false;
+
+	for (int x = 0; x < 16; x++)
+	{
+		for (int z = 0; z < 16; z++)
+		{
+			unsigned short bits = 0;
+			for (int y = 0; y < 16; y++) { if (!volume->getVoxelAt(corner.x + x, corner.y + y, corner.z + z).isAir()) { bits |= 1 << y; } }
+			solidBits[x * 16 + z] = bits;
+
+			// only columns whose top is in this chunk, or was, need a new colour
+			int& height = heightmap->mHeights[x][z];
+			int newHeight = heightmap->findHeight(x, z);
+			if (newHeight >= corner.y && newHeight < corner.y + 16) { heightmap->mColors[x][z] = volume->getVoxelAt(corner.x + x, newHeight, corner.z + z); }
+			else if (newHeight == height) { continue; }
+			else { heightmap->mColors[x][z] = newHeight == ChunkColumnHeightmap::NO_HEIGHT ? EmptyVoxelType : getLoadedVoxel(corner.x + x, newHeight, corner.z + z); }
+			height = newHeight;
+			changed = true;
+		}
+	}
+	if (changed) { changedMinimapColumns.insert(glm::ivec2(chunkPos.x, chunkPos.z)); }
+}
+
+void showChunkIfVisible(const glm::ivec3& pos, VolumeChunk* chunk);
 
 VolumeChunk* initChunk(int x, int y, int z)
 {
@@ -2627,6 +2849,8 @@ VolumeChunk* initChunk(int x, int y, int z)
 	chunk->mVolume.reset(new VoxelVolume(chunkStart.x, chunkStart.y, chunkStart.z, chunkStart.x + 16, chunkStart.y + 16, chunkStart.z + 16));
 	chunk->mMesh.reset(new Mesh());
 	mChunks[glm::ivec3(x, y, z)].reset(chunk);
+	ChunkEventBus::publish(ChunkEvent::CREATED, glm::ivec3(x, y, z), chunk);
+	showChunkIfVisible(glm::ivec3(x, y, z), chunk);
 
 	printf("Inited chunk [%d, %d, %d]\n", x, y, z);
 
@@ -2645,13 +2869,7 @@ void setVoxel(int x, int y, int z, unsigned char r, unsigned char g, unsigned ch
 	if (!chunk->mVolume->setVoxelAt(x, y, z, vtype)) { printf("Failed to set voxel! (%d, %d, %d)\n", x, y, z); return; }
 	chunk->mMeshNeedsUpdate = true;
 
-	// update minimap colors
-	glm::ivec3 chunkMiniPos(chunkPos.x, 0, chunkPos.z);
-	ChunkMinimapColormap* mini;
-	if (mChunkMinimapColors.count(chunkMiniPos) == 0) { mini = new ChunkMinimapColormap(chunk->mVolume->getEnclosingRegion().getLowerCorner()); mChunkMinimapColors[chunkMiniPos].reset(mini); }
-	else { mini = mChunkMinimapColors[chunkMiniPos].get(); }
-
-	mini->setColorAt(x, y, z, vtype);
+	setHeightmapVoxel(chunkPos, x, y, z, vtype);
 }
 
 void setVoxel(int x, int y, int z, unsigned char r, unsigned char g, unsigned char b) { setVoxel(x, y, z, r, g, b, 255); }
@@ -2673,77 +2891,198 @@ const VoxelType& getVoxel(const glm::ivec3& pos) { return getVoxel(pos.x, pos.y,
 
 const VoxelType& getVoxelMinimapColor(int x, int z)
 {
-	glm::ivec3 chunkPos(std::floorf((float)x / 16.0f), 0, std::floorf((float)z / 16.0f));
-	if (mChunkMinimapColors.count(chunkPos) == 0) { return EmptyVoxelType; }
-	return mChunkMinimapColors[chunkPos]->getColorAt(x, z);
+	auto it = mChunkHeightmaps.find(glm::ivec2(floorDiv(x, 16), floorDiv(z, 16)));
+	if (it == mChunkHeightmaps.end()) { return EmptyVoxelType; }
+	return it->second->getColorAt(x, z);
 }
 
-const int getHighestVoxelAt_todo(int x, int z)
+// y of the top solid voxel, -1 if there is none in the chunks created so far
+const int getHighestVoxelAt(int x, int z)
 {
-	glm::ivec3 chunkPos(std::floorf((float)x / 16.0f), 0, std::floorf((float)z / 16.0f));
-	if (mChunkMinimapColors.count(chunkPos) == 0) { return 0; }
-	return mChunkMinimapColors[chunkPos]->mHighestVoxel;
+	auto it = mChunkHeightmaps.find(glm::ivec2(floorDiv(x, 16), floorDiv(z, 16)));
+	if (it == mChunkHeightmaps.end()) { return -1; }
+	int height = it->second->getHeightAt(x, z);
+	return height == ChunkColumnHeightmap::NO_HEIGHT ? -1 : height;
 }
 
-const int getHighestVoxelAt(int x, int z)
+int volumeRenderDistance = 3; // in chunks, adjusted to the frame rate by updateRenderDistance
+int volumeRenderDistanceMin = 2;
+int volumeRenderDistanceMax = 8;
+float volumeGenerationFrameBudget = 4.0f; // milliseconds per frame the main thread spends applying finished chunk work
+
+// prefetching of chunks ahead of the player, see updateChunkPrefetch
+int chunkPrefetchBudget = 6; // chunks, set with -prefetch
+float chunkPrefetchSeconds = 3.0f; // how far ahead the path is predicted
+glm::vec2 chunkPrefetchVelocity;
+glm::vec2 chunkPrefetchLastPos;
+long long chunkPrefetchLastUpdate = 0;
+int chunkPrefetchRequested = 0;
+int chunkPrefetchHits = 0; // installed before the player got in range
+int chunkPrefetchLate = 0; // still in the pipeline when the player got in range
+int chunkPrefetchWasted = 0; // left behind without being reached
+bool chunkMissingUnderPlayer = false;
+int chunkMissingUnderPlayerEvents = 0;
+
+// generation, decoration and meshing of chunks, see the Map Loading region
+std::unique_ptr<ChunkPipeline> chunkPipeline;
+
+void requestChunkMesh(const glm::ivec3& pos, VolumeChunk* chunk);
+void discardChunkWork();
+
+// keeps track of player visits to chunks, for dungeon regeneration and ownership expiry
+class ChunkVisitListener : public IChunkEventListener
 {
-	glm::ivec3 checkPos(x, 0, z);
-	while (getVoxel(checkPos).a != 0) { checkPos.y++; }
-	return checkPos.y;
-}
+public:
+	virtual void onChunkEvent(ChunkEvent event, const glm::ivec3& pos, VolumeChunk* chunk)
+	{
+		if (event == ChunkEvent::ENTERED_RANGE)
+		{
+			// regen ex-dungeon chunks after 24 hours of inactivity. technically, this should check if the dungeon has been completed yet or not.
+			// the old terrain stays until the regenerated volume replaces it
+			if (chunk->mLastVisited != 0 && chunk->mLastVisited + (1000 * 60 * 60 * 24) < Tools::currentTimeMillis() && chunk->mDungeon) { chunk->mNeedsRegeneration = true; }
+
+			printf("onChunkLoad(%d, %d, %d)\n", pos.x, pos.y, pos.z);
+		}
+		else if (event == ChunkEvent::LEFT_RANGE)
+		{
+			chunk->mLastVisited = Tools::currentTimeMillis();
+
+			if (chunk->mOwnerId == 1 && chunk->getRemainingOwnershipTime() <= 0) // owner unloading expired chunks causes ownership loss
+			{
+				chunk->mOwnerId = 0;
+				chunk->mOwnershipStartTime = 0;
+				chunk->mOwnershipDuration = 0;
+			}
 
-int volumeRenderDistance = 3;
-int volumeMaxSurfaceExtractionThreads = 4;
-std::atomic<int> activeSurfaceExtractionThreads = 0;
+			printf("onChunkUnload(%d, %d, %d)\n", pos.x, pos.y, pos.z);
+		}
+	}
+} chunkVisitListener;
 
-void chunkSurfaceExtractProc(VolumeChunk* chunk)
+// puts the terrain of generated chunks into the heightmaps, and with that on the minimap
+class HeightmapChunkListener : public IChunkEventListener
 {
-	chunk->mUpdatedMesh.reset(new Mesh());
-	extractVolumeSurface(chunk->mVolume.get(), chunk->mUpdatedMesh.get());
-	chunk->mUpdatedMeshReady = true;
-	chunk->mMeshNeedsUpdate = false;
-	chunk->mUpdatingMesh = false;
-	activeSurfaceExtractionThreads--;
-}
+public:
+	virtual void onChunkEvent(ChunkEvent event, const glm::ivec3& pos, VolumeChunk* chunk) { setChunkHeightmap(pos, chunk->mVolume.get()); }
+} heightmapChunkListener;
+
+glm::ivec3 getVoxelChunkPos(int x, int y, int z) { return glm::ivec3(std::floorf((float)x / 16.0f), std::floorf((float)y / 16.0f), std::floorf((float)z / 16.0f)); }
+
+glm::ivec3 getVoxelChunkPos(const glm::ivec3& pos) { return getVoxelChunkPos(pos.x, pos.y, pos.z); }
+
+glm::ivec3 getPlayerPositionVoxelPos();
+
+// a box of chunk positions, both corners included
+struct ChunkBox
+{
+	glm::ivec3 mLower;
+	glm::ivec3 mUpper;
+
+	ChunkBox() : mLower(0), mUpper(-1) {} // empty
+	ChunkBox(const glm::ivec3& lower, const glm::ivec3& upper) : mLower(lower), mUpper(upper) {}
+
+	bool contains(const glm::ivec3& pos) const { return pos.x >= mLower.x && pos.x <= mUpper.x && pos.y >= mLower.y && pos.y <= mUpper.y && pos.z >= mLower.z && pos.z <= mUpper.z; }
+	int getVolume() const { return std::max(0, mUpper.x - mLower.x + 1) * std::max(0, mUpper.y - mLower.y + 1) * std::max(0, mUpper.z - mLower.z + 1); }
+
+	bool operator == (const ChunkBox& other) const { return mLower == other.mLower && mUpper == other.mUpper; }
+	bool operator != (const ChunkBox& other) const { return !(*this == other); }
+};
 
-void onChunkLoad(const glm::ivec3& pos, VolumeChunk* chunk)
+// calls func for every position of box that isn't in excluded. rows running through excluded only visit the positions
+// before and after it, so moving the box by a chunk costs about the ring that changed instead of the whole box
+template <typename Func> void forEachChunkOutside(const ChunkBox& box, const ChunkBox& excluded, Func func)
 {
-	// regen ex-dungeon chunks after 24 hours of inactivity. technically, this should check if the dungeon has been completed yet or not
-	if (chunk->mLastVisited != 0 && chunk->mLastVisited + (1000 * 60 * 60 * 24) < Tools::currentTimeMillis() && chunk->mDungeon)
+	for (int x = box.mLower.x; x <= box.mUpper.x; x++)
 	{
-		chunk->mNeedsRegeneration = true;
-		chunk->mVolume->reset();
+		bool xInside = x >= excluded.mLower.x && x <= excluded.mUpper.x;
+		for (int y = box.mLower.y; y <= box.mUpper.y; y++)
+		{
+			if (xInside && y >= excluded.mLower.y && y <= excluded.mUpper.y)
+			{
+				for (int z = box.mLower.z; z <= std::min(box.mUpper.z, excluded.mLower.z - 1); z++) { func(glm::ivec3(x, y, z)); }
+				for (int z = std::max(box.mLower.z, excluded.mUpper.z + 1); z <= box.mUpper.z; z++) { func(glm::ivec3(x, y, z)); }
+			}
+			else
+			{
+				for (int z = box.mLower.z; z <= box.mUpper.z; z++) { func(glm::ivec3(x, y, z)); }
+			}
+		}
 	}
+}
+
+struct VisibleChunk
+{
+	glm::ivec3 mPosition;
+	VolumeChunk* mChunk;
+};
+
+// chunks within render range of the player. the list only changes when the player crosses a chunk border, the range
+// changes or a chunk inside it is created
+ChunkBox visibleChunkBox;
+std::vector<VisibleChunk> visibleChunks;
+
+void showChunkIfVisible(const glm::ivec3& pos, VolumeChunk* chunk)
+{
+	if (chunk->mVisibleIndex >= 0 || !visibleChunkBox.contains(pos)) { return; }
 
-	printf("onChunkLoad(%d, %d, %d)\n", pos.x, pos.y, pos.z);
+	chunk->mVisibleIndex = (int)visibleChunks.size();
+	visibleChunks.push_back({ pos, chunk });
+	ChunkEventBus::publish(ChunkEvent::ENTERED_RANGE, pos, chunk);
 }
 
-void onChunkUnload(const glm::ivec3& pos, VolumeChunk* chunk)
+void hideChunk(const glm::ivec3& pos, VolumeChunk* chunk)
 {
-	chunk->mLastVisited = Tools::currentTimeMillis();
+	if (chunk->mVisibleIndex < 0) { return; }
 
-	if (chunk->mOwnerId == 1 && chunk->getRemainingOwnershipTime() <= 0) // owner unloading expired chunks causes ownership loss
-	{
-		chunk->mOwnerId = 0;
-		chunk->mOwnershipStartTime = 0;
-		chunk->mOwnershipDuration = 0;
-	}
+	// move the last chunk into the gap
+	VisibleChunk& last = visibleChunks.back();
+	last.mChunk->mVisibleIndex = chunk->mVisibleIndex;
+	visibleChunks[chunk->mVisibleIndex] = last;
+	visibleChunks.pop_back();
+	chunk->mVisibleIndex = -1;
+	ChunkEventBus::publish(ChunkEvent::LEFT_RANGE, pos, chunk);
+}
 
-	printf("onChunkUnload(%d, %d, %d)\n", pos.x, pos.y, pos.z);
+// for when all chunks are thrown away
+void resetVisibleChunks()
+{
+	visibleChunks.clear();
+	visibleChunkBox = ChunkBox();
 }
 
-std::unordered_map<glm::ivec3, VolumeChunk*, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> lastRenderChunks;
+void updateVisibleChunks()
+{
+	glm::ivec3 playerVoxel(getPlayerPositionVoxelPos());
+	glm::ivec3 curChunk(getVoxelChunkPos(playerVoxel.x, playerVoxel.y, playerVoxel.z));
+	ChunkBox box(curChunk - glm::ivec3(volumeRenderDistance, 1, volumeRenderDistance), curChunk + glm::ivec3(volumeRenderDistance, 1, volumeRenderDistance));
+	if (box == visibleChunkBox) { return; }
+
+	ChunkBox lastBox = visibleChunkBox;
+	visibleChunkBox = box;
+	if (visibleChunks.capacity() < (size_t)box.getVolume()) { visibleChunks.reserve(box.getVolume()); }
+
+	forEachChunkOutside(lastBox, box, [](const glm::ivec3& pos)
+	{
+		auto it = mChunks.find(pos);
+		if (it != mChunks.end()) { hideChunk(pos, it->second.get()); }
+	});
+	forEachChunkOutside(box, lastBox, [](const glm::ivec3& pos)
+	{
+		auto it = mChunks.find(pos);
+		if (it != mChunks.end()) { showChunkIfVisible(pos, it->second.get()); }
+	});
+}
 
 void renderChunks()
 {
-	std::unordered_map<glm::ivec3, VolumeChunk*, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> renderedChunks;
+	updateVisibleChunks();
 
 	glm::vec3 camPos(cx, 0, cz);
 
-	// go through all loaded chunks to render any within the render distance
-	for (auto it = mChunks.begin(); it != mChunks.end(); it++)
+	// render the visible chunks within the render distance
+	for (auto& visible : visibleChunks)
 	{
-		VolumeChunk* chunk = it->second.get();
+		VolumeChunk* chunk = visible.mChunk;
 
 		// apply max render distance
 		const glm::ivec3& corner = chunk->mVolume.get()->getEnclosingRegion().getLowerCorner();
@@ -2751,51 +3090,13 @@ void renderChunks()
 
 		if (glm::distance(camPos, volumeCenterWorldPos) >= (volumeRenderDistance * 16)) { continue; }
 
-		// update and render chunk geometry
-		if (!chunk->mUpdatingMesh)
-		{
-			if (chunk->mMeshNeedsUpdate && activeSurfaceExtractionThreads < volumeMaxSurfaceExtractionThreads)
-			{
-				activeSurfaceExtractionThreads++;
-				chunk->mUpdatingMesh = true;
-				std::thread t(chunkSurfaceExtractProc, chunk);
-				t.detach();
-			}
-			// with modern buffered rendering, gpu pushes must happen on the main thread, so this is where it'd be done
-			else if (chunk->mUpdatedMeshReady)
-			{
-				chunk->mMesh = std::move(chunk->mUpdatedMesh);
-				chunk->mUpdatedMeshReady = false;
-			}
-		}
-
-		chunk->render();
-
-		renderedChunks[it->first] = it->second.get();
-	}
-
-	// go through all the rendered chunks to determine which were recently loaded
-	for (auto& chunk : renderedChunks)
-	{
-		auto exist = lastRenderChunks.find(chunk.first);
-		if (exist == lastRenderChunks.end()) { onChunkLoad(chunk.first, chunk.second); }
-	}
+		// rebuild edited chunk geometry, the finished mesh is uploaded by the pipeline
+		if (chunk->mMeshNeedsUpdate) { requestChunkMesh(visible.mPosition, chunk); }
 
-	// go through all the chunks rendered last call to determine which were recently unloaded
-	for (auto& chunk : lastRenderChunks)
-	{
-		auto exist = renderedChunks.find(chunk.first);
-		if (exist == renderedChunks.end()) { onChunkUnload(chunk.first, chunk.second); }
+		RenderQueue::submit(RenderPass::SOLID, RenderMaterial::VOXEL_MESH, volumeCenterWorldPos, [chunk]() { chunk->render(); });
 	}
-
-	// update the recently rendered chunk list
-	lastRenderChunks = renderedChunks;
 }
 
-glm::ivec3 getVoxelChunkPos(int x, int y, int z) { return glm::ivec3(std::floorf((float)x / 16.0f), std::floorf((float)y / 16.0f), std::floorf((float)z / 16.0f)); }
-
-glm::ivec3 getVoxelChunkPos(const glm::ivec3& pos) { return getVoxelChunkPos(pos.x, pos.y, pos.z); }
-
 glm::vec3 chunkToWorldPos(const glm::ivec3& pos) { return glm::vec3(pos.x * 16, pos.y * 16, pos.z * 16); }
 
 #pragma endregion
@@ -2824,6 +3125,9 @@ float mapleMapScaling = 10.0f;
 
 void switchMapleMap(int mapId)
 {
+	for (auto& chunk : mChunks) { ChunkEventBus::publish(ChunkEvent::EVICTED, chunk.first, chunk.second.get()); }
+	discardChunkWork();
+	resetVisibleChunks();
 	mChunks.clear();
 
 	loadedMapleMap = MapleMapFactory::getInstance().loadMapFromWz(mapId);
@@ -2908,7 +3212,9 @@ void charAttemptEnterPortal()
 
 void drawLoadedMapleMap()
 {
+	RenderQueue::beginFrame(glm::vec3(cx, cy, cz));
 	renderChunks();
+	RenderQueue::execute();
 
 	// render portals
 	int numMapPortals = 0;
@@ -2916,12 +3222,12 @@ void drawLoadedMapleMap()
 	{
 		if (portal.second->getType() == MaplePortal::MAP_PORTAL)
 		{
-			glPushMatrix();
-			glColor3f(0.2f, 0.2f, 1.0f);
+			Renderer::pushMatrix();
+			Renderer::color3f(0.2f, 0.2f, 1.0f);
 			const glm::ivec2& pos = portal.second->getPosition();
-			glTranslatef((float)pos.x / mapleMapScaling, (float)pos.y / mapleMapScaling, 0.0f);
+			Renderer::translatef((float)pos.x / mapleMapScaling, (float)pos.y / mapleMapScaling, 0.0f);
 			glutSolidSphere(2.0f, 20, 20);
-			glPopMatrix();
+			Renderer::popMatrix();
 
 			numMapPortals++;
 		}
@@ -2930,12 +3236,12 @@ void drawLoadedMapleMap()
 	// render spawn points
 	for (auto& sp : loadedMapleMap->getSpawnPoints())
 	{
-		glPushMatrix();
-		glColor3f(1.0f, 0.2f, 0.2f);
+		Renderer::pushMatrix();
+		Renderer::color3f(1.0f, 0.2f, 0.2f);
 		const glm::ivec2& pos = sp->getPosition();
-		glTranslatef((float)pos.x / mapleMapScaling, (float)pos.y / mapleMapScaling, 0.0f);
+		Renderer::translatef((float)pos.x / mapleMapScaling, (float)pos.y / mapleMapScaling, 0.0f);
 		glutSolidSphere(2.0f, 20, 20);
-		glPopMatrix();
+		Renderer::popMatrix();
 	}
 
 	// render npcs
@@ -2944,12 +3250,12 @@ void drawLoadedMapleMap()
 	{
 		if (mo.second->getType() == MapleMapObjectType::NPC)
 		{
-			glPushMatrix();
-			glColor3f(0.2f, 1.0f, 0.2f);
+			Renderer::pushMatrix();
+			Renderer::color3f(0.2f, 1.0f, 0.2f);
 			const glm::ivec2& pos = mo.second->getPosition();
-			glTranslatef((float)pos.x / mapleMapScaling, (float)pos.y / mapleMapScaling, 0.0f);
+			Renderer::translatef((float)pos.x / mapleMapScaling, (float)pos.y / mapleMapScaling, 0.0f);
 			glutSolidSphere(2.0f, 20, 20);
-			glPopMatrix();
+			Renderer::popMatrix();
 
 			numNPCs++;
 		}
@@ -2968,11 +3274,11 @@ void drawLoadedMapleMap()
 	}
 
 	// render player character
-	glPushMatrix();
-	glColor3f(0.46f, 0.29f, 0.587f);
-	glTranslatef(charPos.x, charPos.y, charPos.z);
+	Renderer::pushMatrix();
+	Renderer::color3f(0.46f, 0.29f, 0.587f);
+	Renderer::translatef(charPos.x, charPos.y, charPos.z);
 	glutSolidSphere(2.0f, 20, 20);
-	glPopMatrix();
+	Renderer::popMatrix();
 }
 
 void drawLoadedMapleMapStatistics()
@@ -3154,12 +3460,12 @@ public:
 		const VoxelType& newVoxel = getVoxel(newVoxelPos);
 
 		// DEBUG: draw player position voxel
-		glPushMatrix();
-		glTranslatef((float)newVoxelPos.x, (float)newVoxelPos.y, (float)newVoxelPos.z);
-		glTranslatef(0.5f, 0.5f, 0.5f);
-		glColor3f(0.5f, 0.5f, 0.5f);
-		glutWireCube(1.0f);
-		glPopMatrix();
+		Renderer::pushMatrix();
+		Renderer::translatef((float)newVoxelPos.x, (float)newVoxelPos.y, (float)newVoxelPos.z);
+		Renderer::translatef(0.5f, 0.5f, 0.5f);
+		Renderer::color3f(0.5f, 0.5f, 0.5f);
+		Renderer::wireCube(1.0f);
+		Renderer::popMatrix();
 
 		if (newVoxelPos != curVoxelPos)
 		{
@@ -3657,27 +3963,27 @@ void drawEnemy(int id)
 		bodyColor.b = 1.0f;
 	}
 
-	glColor3f(bodyColor.r, bodyColor.g, bodyColor.b);
+	Renderer::color3f(bodyColor.r, bodyColor.g, bodyColor.b);
 
 	// Draw Body
-	glTranslatef(0.0f, 0.75f, 0.0f);
+	Renderer::translatef(0.0f, 0.75f, 0.0f);
 	glutSolidSphere(0.75f, 20, 20);
 
 	// Draw Head
-	glTranslatef(0.0f, 1.0f, 0.0f);
+	Renderer::translatef(0.0f, 1.0f, 0.0f);
 	glutSolidSphere(0.25f, 20, 20);
 
 	// Draw Eyes
-	glPushMatrix();
-	glColor3f(0.0f, 0.0f, 0.0f);
-	glTranslatef(0.05f, 0.10f, 0.18f);
+	Renderer::pushMatrix();
+	Renderer::color3f(0.0f, 0.0f, 0.0f);
+	Renderer::translatef(0.05f, 0.10f, 0.18f);
 	glutSolidSphere(0.05f, 10, 10);
-	glTranslatef(-0.1f, 0.0f, 0.0f);
+	Renderer::translatef(-0.1f, 0.0f, 0.0f);
 	glutSolidSphere(0.05f, 10, 10);
-	glPopMatrix();
+	Renderer::popMatrix();
 
 	// Draw Nose
-	glColor3f(1.0f, 0.5f, 0.5f);
+	Renderer::color3f(1.0f, 0.5f, 0.5f);
 	glutSolidCone(0.08f, 0.5f, 10, 2);
 }
 
@@ -3685,6 +3991,7 @@ class IEnemyMovementController
 {
 public:
 	virtual bool invalidPathfindNode(const glm::ivec2& node) = 0;
+	virtual bool blockedPathfindStep(const glm::ivec2& from, const glm::ivec2& to) = 0; // a wall between neighbouring nodes
 	virtual glm::ivec2 worldToMazePos(const glm::vec3& worldPos) = 0;
 	virtual glm::vec3 mazeToWorldPos(const glm::ivec2& pos) = 0;
 };
@@ -3692,23 +3999,46 @@ public:
 class Enemy : public CombatEntity
 {
 private:
+	// a path being calculated on the job system. the enemy may be gone by the time it is done, so it only keeps the
+	// result and a pointer back that the enemy clears when destroyed (both on the main thread)
+	struct PathfindRequest
+	{
+		Enemy* mEnemy;
+		std::vector<glm::ivec2> mPath;
+
+		PathfindRequest(Enemy* enemy) : mEnemy(enemy) {}
+	};
+
 	glm::vec3 mMoveDirection;
 	std::vector<glm::ivec2> mPathfindPath;
 	long long mLastPathfindCalcTime = 0;
-	std::vector<glm::ivec2> mLatestPathfindPath;
-	bool mNewerPathfindAvailable = false;
-	bool mCurrentlyPathfinding = false;
+	std::shared_ptr<PathfindRequest> mPathfindRequest;
 	IEnemyMovementController* mMovementController;
 
 	long long mLastAttackTime = 0;
 
-	static void calculateMovementPath(Enemy* enemy, const glm::ivec2& startPos, const glm::ivec2& targetPos)
+	void calculateMovementPath(const glm::ivec2& startPos, const glm::ivec2& targetPos)
 	{
-		enemy->mCurrentlyPathfinding = true;
-		AStar::Pathfinder pathfinder;
-		enemy->mLatestPathfindPath = pathfinder.findPath(startPos, targetPos, [&](const glm::ivec2& pos) { return enemy->mMovementController->invalidPathfindNode(pos); });
-		enemy->mNewerPathfindAvailable = true;
-		enemy->mCurrentlyPathfinding = false;
+		std::shared_ptr<PathfindRequest> request(new PathfindRequest(this));
+		IEnemyMovementController* controller = mMovementController;
+		mPathfindRequest = request;
+
+		JobHandle job = JobSystem::submit([request, controller, startPos, targetPos]()
+		{
+			AStar::Pathfinder pathfinder;
+			request->mPath = pathfinder.findPath(startPos, targetPos, [controller](const glm::ivec2& pos) { return controller->invalidPathfindNode(pos); },
+				[controller](const glm::ivec2& from, const glm::ivec2& to) { return controller->blockedPathfindStep(from, to); });
+		});
+
+		JobSystem::thenOnMainThread(job, [request]()
+		{
+			Enemy* enemy = request->mEnemy;
+			if (!enemy) { return; }
+
+			// close enough enemies walk straight at the player and don't need the path anymore
+			if (glm::distance(enemy->mPosition, glm::vec3(cx, 0.0f, cz)) > 7.0f) { enemy->mPathfindPath.swap(request->mPath); }
+			enemy->mPathfindRequest.reset();
+		});
 	}
 
 	int mId;
@@ -3720,6 +4050,8 @@ public:
 		loadEnemyStats(this, id);
 	}
 
+	~Enemy() { if (mPathfindRequest) { mPathfindRequest->mEnemy = 0; } }
+
 	void update(float elapsed)
 	{
 		if (!mMovementController) { return; }
@@ -3727,28 +4059,17 @@ public:
 		glm::vec3 playerPos(cx, 0.0f, cz);
 		float distToPlayer = glm::distance(mPosition, playerPos);
 
-		// update pathfinding
+		// update pathfinding, finished paths are swapped in by the job system's main thread queue
 		if (distToPlayer > 7.0f)
 		{
-			// swap latest calculated pathfind path in
-			if (mNewerPathfindAvailable)
-			{
-				mPathfindPath = mLatestPathfindPath;
-				mNewerPathfindAvailable = false;
-			}
-
 			// determine if path should be recalculated
-			if (!mCurrentlyPathfinding && Tools::currentTimeMillis() - mLastPathfindCalcTime > 3000)
+			if (!mPathfindRequest && Tools::currentTimeMillis() - mLastPathfindCalcTime > 3000)
 			{
 				mLastPathfindCalcTime = Tools::currentTimeMillis();
 
 				glm::ivec2 startPos(mMovementController->worldToMazePos(mPosition));
 				glm::ivec2 targetPos(mMovementController->worldToMazePos(playerPos));
-				if (!mMovementController->invalidPathfindNode(startPos) && !mMovementController->invalidPathfindNode(targetPos)) // invalid endpoints crash
-				{
-					std::thread t(std::bind(calculateMovementPath, this, startPos, targetPos));
-					t.detach();
-				}
+				if (!mMovementController->invalidPathfindNode(startPos) && !mMovementController->invalidPathfindNode(targetPos)) { calculateMovementPath(startPos, targetPos); } // invalid endpoints crash
 			}
 		}
 		else
@@ -3790,19 +4111,19 @@ public:
 	void draw()
 	{
 		// draw mesh
-		glPushMatrix();
-		glTranslatef(mPosition.x, mPosition.y, mPosition.z);
+		Renderer::pushMatrix();
+		Renderer::translatef(mPosition.x, mPosition.y, mPosition.z);
 		drawEnemy(mId);
-		glPopMatrix();
+		Renderer::popMatrix();
 
 		// draw aabb
-		if (Tools::currentTimeMillis() - mLastAttackTime <= 1500) { glColor3f(1.0f, 0.0f, 0.0f); }
-		else { glColor3f(0.0f, 0.5f, 0.5f); }
-		glPushMatrix();
-		glTranslatef(mPosition.x, mPosition.y + 1, mPosition.z);
-		glScalef(2, 2, 2);
-		glutWireCube(1.0f);
-		glPopMatrix();
+		if (Tools::currentTimeMillis() - mLastAttackTime <= 1500) { Renderer::color3f(1.0f, 0.0f, 0.0f); }
+		else { Renderer::color3f(0.0f, 0.5f, 0.5f); }
+		Renderer::pushMatrix();
+		Renderer::translatef(mPosition.x, mPosition.y + 1, mPosition.z);
+		Renderer::scalef(2, 2, 2);
+		Renderer::wireCube(1.0f);
+		Renderer::popMatrix();
 	}
 };
 
@@ -3932,32 +4253,39 @@ public:
 	void draw()
 	{
 		glm::vec3 clr = isPlayerNearAnyPortal() ? glm::vec3(0.35f, 0.65f, 0.15f) : glm::vec3(0.25f, 0.25f, 0.8f);
-		glColor4f(clr.r, clr.g, clr.b, 0.75f);
+		Renderer::color4f(clr.r, clr.g, clr.b, 0.75f);
 
-		glPushMatrix();
-		glTranslatef((float)mPosition.x, (float)mPosition.y, (float)mPosition.z);
-		glTranslatef(0.5f, 0.875f, 0.5f);
-		glScalef(1.0f, 1.75f, 1.0f);
+		Renderer::pushMatrix();
+		Renderer::translatef((float)mPosition.x, (float)mPosition.y, (float)mPosition.z);
+		Renderer::translatef(0.5f, 0.875f, 0.5f);
+		Renderer::scalef(1.0f, 1.75f, 1.0f);
 		glutSolidSphere(1.0, 10, 10);
-		glPopMatrix();
+		Renderer::popMatrix();
 	}
 
 	bool isPlayerNearby() { return glm::distance(glm::vec3(cx, cy, cz), glm::vec3(mPosition)) <= 3.0f; }
 };
 
+// cell size of the grids world features are looked up in, in chunks. about the size of a town
+const int FEATURE_GRID_CELL_CHUNKS = 64;
+
 std::vector<std::unique_ptr<Portal>> portals;
+FeatureGrid<Portal> portalGrid(FEATURE_GRID_CELL_CHUNKS); // by chunk column
 
 Portal* addPortal(int x, int y, int z, const std::string& name)
 {
 	Portal* ret = new Portal(glm::ivec3(x, y, z), name);
 	portals.push_back(std::unique_ptr<Portal>(ret));
+	glm::ivec2 chunk(floorDiv(x, 16), floorDiv(z, 16));
+	portalGrid.insert(ret, chunk, chunk);
 	return ret;
 }
 
 bool isPlayerNearAnyPortal()
 {
-	for (auto& portal : portals) { if (portal->isPlayerNearby()) { return true; } }
-	return false;
+	// portals count as near within a few voxels, so only the ones next to the player's chunk can be
+	glm::ivec2 chunk(floorDiv((int)std::floorf(cx), 16), floorDiv((int)std::floorf(cz), 16));
+	return portalGrid.findInArea(chunk - 1, chunk + 1, [](Portal* portal) { return portal->isPlayerNearby(); });
 }
 
 #pragma endregion
@@ -4001,7 +4329,7 @@ void updateInformationHistory()
 	{
 		InformationHistoryEntry* entry = informationHistory.at(i).get();
 		int remainTime = entry->getRemainingTime();
-		glColor4f(0.0f, 0.0f, 0.0f, remainTime > 1000 ? 1.0f : glm::mix(0.1f, 1.0f, remainTime / 1000.0f));
+		Renderer::color4f(0.0f, 0.0f, 0.0f, remainTime > 1000 ? 1.0f : glm::mix(0.1f, 1.0f, remainTime / 1000.0f));
 		Renderer::renderString(windowWidth - 300, 700 - (i * 20), RenderFont::BITMAP_HELVETICA_18, entry->getMessage());
 	}
 }
@@ -4020,10 +4348,10 @@ void updateClickSelectedItem()
 		ItemInfo* info = ItemInformationProvider::getItemInfo(clickSelectedItem->getItemId());
 		if (info)
 		{
-			glPushMatrix();
-			glTranslatef((float)UIWindowManager::getMousePos().x + 5, (float)UIWindowManager::getMousePos().y + 5, 0);
+			Renderer::pushMatrix();
+			Renderer::translatef((float)UIWindowManager::getMousePos().x + 5, (float)UIWindowManager::getMousePos().y + 5, 0);
 			info->drawIcon();
-			glPopMatrix();
+			Renderer::popMatrix();
 		}
 	}
 }
@@ -4041,17 +4369,17 @@ protected:
 			short slot = i + 1;
 			Item* item = playerInventoryItems.getItem(slot);
 
-			glColor4f(0.0f, 0.0f, 0.0f, item ? 0.75f : 0.25f);
+			Renderer::color4f(0.0f, 0.0f, 0.0f, item ? 0.75f : 0.25f);
 			Renderer::drawQuad2D(5 + (col * 52), 5 + (row * 52), 48, 48);
 			if (item)
 			{
-				glColor4f(1.0f, 1.0f, 1.0f, 0.25f);
+				Renderer::color4f(1.0f, 1.0f, 1.0f, 0.25f);
 				text(5 + (col * 52), 5 + (row * 52) + 13, RenderFont::BITMAP_8_BY_13, std::to_string(item->getItemId() / 1000000) + " - " + std::to_string(item->getItemId() % 1000000)); // debug
 
 				// show quantity for non-equips
 				if (item->getInventoryType() != InventoryType::EQUIP)
 				{
-					glColor3f(1.0f, 1.0f, 1.0f);
+					Renderer::color3f(1.0f, 1.0f, 1.0f);
 					std::string quantityStr = std::to_string(item->getQuantity());
 					text(5 + (col * 52) + 45 - Renderer::getStringWidth(RenderFont::BITMAP_HELVETICA_12, quantityStr), 5 + (row * 52) + 45, RenderFont::BITMAP_HELVETICA_12, quantityStr);
 				}
@@ -4060,10 +4388,10 @@ protected:
 				ItemInfo* info = ItemInformationProvider::getItemInfo(item->getItemId());
 				if (info)
 				{
-					glPushMatrix();
-					glTranslatef((float)(5 + (col * 52)), (float)(5 + (row * 52)), 0.0f);
+					Renderer::pushMatrix();
+					Renderer::translatef((float)(5 + (col * 52)), (float)(5 + (row * 52)), 0.0f);
 					info->drawIcon();
-					glPopMatrix();
+					Renderer::popMatrix();
 				}
 			}
 		}
@@ -4186,21 +4514,21 @@ protected:
 			short slot = i + 1;
 			Item* item = playerEquipmentItems.getItem(slot);
 
-			glColor4f(0.0f, 0.0f, 0.0f, item ? 0.75f : 0.25f);
+			Renderer::color4f(0.0f, 0.0f, 0.0f, item ? 0.75f : 0.25f);
 			Renderer::drawQuad2D(5 + (col * 52), 5 + (row * 52), 48, 48);
 			if (item)
 			{
-				glColor4f(1.0f, 1.0f, 1.0f, 0.25f);
+				Renderer::color4f(1.0f, 1.0f, 1.0f, 0.25f);
 				text(5 + (col * 52), 5 + (row * 52) + 13, RenderFont::BITMAP_8_BY_13, std::to_string(item->getItemId() / 1000000) + " - " + std::to_string(item->getItemId() % 1000000)); // debug
 
 				// draw icon if loaded
 				ItemInfo* info = ItemInformationProvider::getItemInfo(item->getItemId());
 				if (info)
 				{
-					glPushMatrix();
-					glTranslatef((float)(5 + (col * 52)), (float)(5 + (row * 52)), 0.0f);
+					Renderer::pushMatrix();
+					Renderer::translatef((float)(5 + (col * 52)), (float)(5 + (row * 52)), 0.0f);
 					info->drawIcon();
-					glPopMatrix();
+					Renderer::popMatrix();
 				}
 			}
 		}
@@ -4281,10 +4609,10 @@ void updateClickSelectedSkill()
 	if (clickSelectedSkill)
 	{
 		SkillInfo* skillInfo = SkillInformationProvider::getSkillInfo(clickSelectedSkill->getId());
-		glPushMatrix();
-		glTranslatef((float)UIWindowManager::getMousePos().x + 5, (float)UIWindowManager::getMousePos().y + 5, 0);
+		Renderer::pushMatrix();
+		Renderer::translatef((float)UIWindowManager::getMousePos().x + 5, (float)UIWindowManager::getMousePos().y + 5, 0);
 		skillInfo->drawIcon();
-		glPopMatrix();
+		Renderer::popMatrix();
 	}
 }
 
@@ -4301,19 +4629,19 @@ protected:
 			int y = 5 + (i * 52);
 
 			// icon background tile first
-			glColor4f(0.0f, 0.0f, 0.0f, 0.50f);
+			Renderer::color4f(0.0f, 0.0f, 0.0f, 0.50f);
 			quad(5, y, 48, 48);
 			// draw icon
-			glPushMatrix();
-			glTranslatef(5.0f, (float)y, 0.0f);
+			Renderer::pushMatrix();
+			Renderer::translatef(5.0f, (float)y, 0.0f);
 			skillInfo->drawIcon();
-			glPopMatrix();
+			Renderer::popMatrix();
 			// draw info
-			glColor4f(0.0f, 1.0f, 0.0f, 0.2f);
+			Renderer::color4f(0.0f, 1.0f, 0.0f, 0.2f);
 			quad(55, y, 325, 48);
-			glColor4f(0.0f, 1.0f, 0.0f, 0.8f);
+			Renderer::color4f(0.0f, 1.0f, 0.0f, 0.8f);
 			quad(55, y, calcProgressWidth(charSkill->getExp(), charSkill->getLevelUpExp(), 325), 48);
-			glColor3f(0.0f, 0.0f, 0.0f);
+			Renderer::color3f(0.0f, 0.0f, 0.0f);
 			text(55, y + 20, RenderFont::BITMAP_HELVETICA_18, skillInfo->getName());
 			text(100, y + 40, RenderFont::BITMAP_HELVETICA_12, "Lv. " + std::to_string(charSkill->getLevel()) + " (" + std::to_string(charSkill->getExp()) + " / " + std::to_string(charSkill->getLevelUpExp()) + ")");
 		}
@@ -4357,9 +4685,9 @@ protected:
 	{
 		for (unsigned int i = 0; i < shopItems.size(); i++)
 		{
-			glColor4f(0.0f, 0.0f, 0.0f, 0.75f);
+			Renderer::color4f(0.0f, 0.0f, 0.0f, 0.75f);
 			quad(5, 5 + (i * 29), 175, 25);
-			glColor4f(1.0f, 1.0f, 1.0f, 0.75f);
+			Renderer::color4f(1.0f, 1.0f, 1.0f, 0.75f);
 			text(5, 25 + (i * 29), RenderFont::BITMAP_HELVETICA_18, "item id " + std::to_string(shopItems[i]));
 		}
 	}
@@ -4416,24 +4744,24 @@ void drawDialogueWindow()
 {
 	if (!dialogueVisible) { return; }
 
-	glColor4f(0.0f, 0.0f, 0.0f, 0.75f);
+	Renderer::color4f(0.0f, 0.0f, 0.0f, 0.75f);
 	Renderer::drawQuad2D(395, 95, 410, 340);
-	glColor4f(1.0f, 1.0f, 1.0f, 0.75f);
+	Renderer::color4f(1.0f, 1.0f, 1.0f, 0.75f);
 	Renderer::drawQuad2D(400, 100, 400, 330);
-	glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
+	Renderer::color4f(0.0f, 0.0f, 0.0f, 1.0f);
 	Renderer::renderString(475, 120, RenderFont::BITMAP_HELVETICA_18, "Dialogue");
 
 	Renderer::renderString(405, 150, RenderFont::BITMAP_HELVETICA_18, activeDialogueWindow->getMessage());
 
 	// buttons
-	glColor4f(0.0f, 0.0f, 0.0f, 0.75f);
+	Renderer::color4f(0.0f, 0.0f, 0.0f, 0.75f);
 	Renderer::drawQuad2D(500, 405, 100, 20);
-	glColor4f(1.0f, 1.0f, 1.0f, 0.75f);
+	Renderer::color4f(1.0f, 1.0f, 1.0f, 0.75f);
 	Renderer::renderString(540, 425, RenderFont::BITMAP_HELVETICA_18, "OK");
 
-	glColor4f(0.0f, 0.0f, 0.0f, 0.75f);
+	Renderer::color4f(0.0f, 0.0f, 0.0f, 0.75f);
 	Renderer::drawQuad2D(610, 405, 100, 20);
-	glColor4f(1.0f, 1.0f, 1.0f, 0.75f);
+	Renderer::color4f(1.0f, 1.0f, 1.0f, 0.75f);
 	Renderer::renderString(625, 425, RenderFont::BITMAP_HELVETICA_18, "Cancel");
 }
 
@@ -4555,9 +4883,9 @@ void updateClickSelectedKeybind()
 {
 	if (clickSelectedKeybind)
 	{
-		glColor4f(0.5f, 0.5f, 0.5f, 0.5f);
+		Renderer::color4f(0.5f, 0.5f, 0.5f, 0.5f);
 		Renderer::drawQuad2D(UIWindowManager::getMousePos().x + 5, UIWindowManager::getMousePos().y + 5, 48, 48);
-		glColor4f(1.0f, 1.0f, 1.0f, 0.5f);
+		Renderer::color4f(1.0f, 1.0f, 1.0f, 0.5f);
 		std::vector<std::string> parts = Tools::StringUtil::explode(clickSelectedKeybind->name, ' ');
 		for (unsigned int i = 0; i < parts.size(); i++)
 		{
@@ -4574,17 +4902,17 @@ protected:
 		// keyboard display area
 		for (auto& keybind : keybinds)
 		{
-			glColor4f(0.0f, 0.0f, 0.0f, 0.75f);
+			Renderer::color4f(0.0f, 0.0f, 0.0f, 0.75f);
 			quad(keybind.second.position.x, keybind.second.position.y, keybind.second.size.x, keybind.second.size.y);
 			
 			if (keybind.second.type == Keybinding::Type::INTERNAL) // bound internal actions
 			{
 				KeybindingAction* action = getKeybindingActionById(keybind.second.actionId);
 				// deeper background
-				glColor4f(0.5f, 0.5f, 0.5f, 0.75f);
+				Renderer::color4f(0.5f, 0.5f, 0.5f, 0.75f);
 				quad(keybind.second.position.x, keybind.second.position.y, keybind.second.size.x, keybind.second.size.y);
 				// action text
-				glColor4f(1.0f, 1.0f, 1.0f, 0.75f);
+				Renderer::color4f(1.0f, 1.0f, 1.0f, 0.75f);
 				std::vector<std::string> parts = Tools::StringUtil::explode(action->name, ' ');
 				for (unsigned int i = 0; i < parts.size(); i++)
 				{
@@ -4595,33 +4923,33 @@ protected:
 			{
 				SkillInfo* skillInfo = SkillInformationProvider::getSkillInfo(keybind.second.actionId);
 				// deeper background
-				glColor4f(0.5f, 0.5f, 0.5f, 0.75f);
+				Renderer::color4f(0.5f, 0.5f, 0.5f, 0.75f);
 				quad(keybind.second.position.x, keybind.second.position.y, keybind.second.size.x, keybind.second.size.y);
 				// skill icon
-				glPushMatrix();
-				glTranslatef((float)keybind.second.position.x, (float)keybind.second.position.y, 0);
+				Renderer::pushMatrix();
+				Renderer::translatef((float)keybind.second.position.x, (float)keybind.second.position.y, 0);
 				skillInfo->drawIcon();
-				glPopMatrix();
+				Renderer::popMatrix();
 			}
 			else if (keybind.second.type == Keybinding::Type::ITEM) // bound items
 			{
 				ItemInfo* itemInfo = ItemInformationProvider::getItemInfo(keybind.second.actionId);
 				// deeper background
-				glColor4f(0.5f, 0.5f, 0.5f, 0.75f);
+				Renderer::color4f(0.5f, 0.5f, 0.5f, 0.75f);
 				quad(keybind.second.position.x, keybind.second.position.y, keybind.second.size.x, keybind.second.size.y);
 				// skill icon
-				glPushMatrix();
-				glTranslatef((float)keybind.second.position.x, (float)keybind.second.position.y, 0);
+				Renderer::pushMatrix();
+				Renderer::translatef((float)keybind.second.position.x, (float)keybind.second.position.y, 0);
 				itemInfo->drawIcon();
-				glPopMatrix();
+				Renderer::popMatrix();
 			}
 
-			glColor4f(1.0f, 1.0f, 1.0f, 0.75f);
+			Renderer::color4f(1.0f, 1.0f, 1.0f, 0.75f);
 			text(5 + keybind.second.position.x, 45 + keybind.second.position.y, RenderFont::BITMAP_9_BY_15, keybind.second.text);
 		}
 
 		// all internal action display area
-		glColor3f(0.25f, 0.25f, 0.25f);
+		Renderer::color3f(0.25f, 0.25f, 0.25f);
 		quad(5, 325, 650, 175);
 
 		for (unsigned int i = 0; i < keybindingActions.size(); i++)
@@ -4630,9 +4958,9 @@ protected:
 			int col = i % 6;
 
 			KeybindingAction* action = keybindingActions[i].get();
-			glColor4f(0.5f, 0.5f, 0.5f, action->boundTo ? 0.25f : 0.75f);
+			Renderer::color4f(0.5f, 0.5f, 0.5f, action->boundTo ? 0.25f : 0.75f);
 			quad(10 + (col * 52), 330 + (row * 52), 48, 48);
-			glColor4f(1.0f, 1.0f, 1.0f, action->boundTo ? 0.25f : 0.75f);
+			Renderer::color4f(1.0f, 1.0f, 1.0f, action->boundTo ? 0.25f : 0.75f);
 			std::vector<std::string> parts = Tools::StringUtil::explode(action->name, ' ');
 			for (unsigned int ii = 0; ii < parts.size(); ii++)
 			{
@@ -4864,35 +5192,41 @@ private:
 	glm::ivec2 mDragStart;
 	glm::ivec2 mDragDisplayOffset;
 	glm::ivec2 mDisplaySize;
+	int mZoomLevel = 0;
+
+	// voxels covered by a single map pixel
+	int getScale() { return 1 << mZoomLevel; }
+
+	glm::ivec2 worldToMap(int x, int z) { return glm::ivec2(10 + floorDiv(x - mDisplayOffset.x, getScale()), 10 + floorDiv(z - mDisplayOffset.y, getScale())); }
+
+	void setZoomLevel(int level)
+	{
+		level = std::max(0, std::min(level, MinimapTilePyramid::MAX_LEVEL));
+
+		// keep the center of the view in place
+		glm::ivec2 center = mDisplayOffset + (mDisplaySize * getScale()) / 2;
+		mZoomLevel = level;
+		mDisplayOffset = center - (mDisplaySize * getScale()) / 2;
+	}
 
 protected:
 	virtual void draw()
 	{
-		for (int x = 0; x < mDisplaySize.x; x++)
-		{
-			for (int z = 0; z < mDisplaySize.y; z++)
-			{
-				const VoxelType& type = getVoxelMinimapColor(mDisplayOffset.x + x, mDisplayOffset.y + z);
-				if (type.a != 0)
-				{
-					glm::vec3 clr = type.toVertexColor();
-					glColor4f(clr.r, clr.g, clr.b, Renderer::BYTE_TO_FLOAT_COLOR(type.a));
-					quad(10 + x, 10 + z, 1, 1);
-				}
-			}
-		}
+		minimapTiles.draw(mZoomLevel, glm::ivec2(floorDiv(mDisplayOffset.x, getScale()), floorDiv(mDisplayOffset.y, getScale())), glm::ivec2(10, 10), mDisplaySize);
 
 		// draw portals
 		glm::vec3 clr = isPlayerNearAnyPortal() ? glm::vec3(0.35f, 0.65f, 0.15f) : glm::vec3(0.25f, 0.25f, 0.8f);
-		glColor4f(clr.r, clr.g, clr.b, 0.75f);
+		Renderer::color4f(clr.r, clr.g, clr.b, 0.75f);
 		for (auto& portal : portals)
 		{
-			quad(10 + -mDisplayOffset.x + portal->getPosition().x - 5, 10 + -mDisplayOffset.y + portal->getPosition().z - 5, 11, 11);
+			glm::ivec2 mapPos = worldToMap((int)portal->getPosition().x, (int)portal->getPosition().z);
+			quad(mapPos.x - 5, mapPos.y - 5, 11, 11);
 		}
 
 		// draw player position
-		glColor4f(0.0f, 0.0f, 0.0f, 0.75f);
-		quad(10 + -mDisplayOffset.x + (int)cx - 5, 10 + -mDisplayOffset.y + (int)cz - 5, 11, 11);
+		glm::ivec2 playerMapPos = worldToMap((int)cx, (int)cz);
+		Renderer::color4f(0.0f, 0.0f, 0.0f, 0.75f);
+		quad(playerMapPos.x - 5, playerMapPos.y - 5, 11, 11);
 
 		// list all the portals on the side with their position
 		glm::ivec2 mousePos(getClientAreaMousePos());
@@ -4903,23 +5237,38 @@ protected:
 			rectHigher += rectLower;
 			if (mousePos.x >= rectLower.x && mousePos.x <= rectHigher.x && mousePos.y >= rectLower.y && mousePos.y <= rectHigher.y)
 			{
-				glColor4f(0.5f, 0.5f, 0.5f, 0.5f);
+				Renderer::color4f(0.5f, 0.5f, 0.5f, 0.5f);
 				quad(rectLower.x, rectLower.y, 450, 18);
 			}
-			glColor3f(0.0f, 0.0f, 0.0f);
+			Renderer::color3f(0.0f, 0.0f, 0.0f);
 			text(690, 30 + (i * 20), RenderFont::BITMAP_HELVETICA_18, portals[i]->getName() + " (" + to_string(portals[i]->getPosition()) + ")");
 		}
 
+		// zoom buttons
+		Renderer::color4f(0.5f, 0.5f, 0.5f, 0.5f);
+		quad(580, 522, 40, 22);
+		quad(630, 522, 40, 22);
+		Renderer::color3f(0.0f, 0.0f, 0.0f);
+		text(595, 540, RenderFont::BITMAP_HELVETICA_18, "-");
+		text(644, 540, RenderFont::BITMAP_HELVETICA_18, "+");
+
 		// show current display offset
-		text(10, 540, RenderFont::BITMAP_HELVETICA_18, "Showing (" + to_string(mDisplayOffset) + ") to (" + to_string(glm::ivec2(mDisplayOffset.x + 670, mDisplayOffset.y + 500)) + ")");
+		text(10, 540, RenderFont::BITMAP_HELVETICA_18, "Showing (" + to_string(mDisplayOffset) + ") to (" + to_string(mDisplayOffset + mDisplaySize * getScale()) + ") | Zoom 1:" + std::to_string(getScale()));
 	}
 
 	virtual void click(int x, int y)
 	{
+		// check for zoom button clicks
+		if (y >= 522 && y <= 544)
+		{
+			if (x >= 580 && x <= 620) { setZoomLevel(mZoomLevel + 1); }
+			else if (x >= 630 && x <= 670) { setZoomLevel(mZoomLevel - 1); }
+		}
+
 		// check for portal clicks on the map
 		for (auto& portal : portals)
 		{
-			glm::ivec2 rectLower(10 + -mDisplayOffset.x + portal->getPosition().x - 5, 10 + -mDisplayOffset.y + portal->getPosition().z - 5);
+			glm::ivec2 rectLower(worldToMap((int)portal->getPosition().x, (int)portal->getPosition().z) - glm::ivec2(5, 5));
 			glm::ivec2 rectHigher(11, 11);
 			rectHigher += rectLower;
 			if (x >= rectLower.x && x <= rectHigher.x && y >= rectLower.y && y <= rectHigher.y)
@@ -4938,7 +5287,7 @@ protected:
 			rectHigher += rectLower;
 			if (x >= rectLower.x && x <= rectHigher.x && y >= rectLower.y && y <= rectHigher.y)
 			{
-				mDisplayOffset = glm::ivec2(portals[i]->getPosition().x - (mDisplaySize.x / 2), portals[i]->getPosition().z - (mDisplaySize.y / 2));
+				mDisplayOffset = glm::ivec2(portals[i]->getPosition().x, portals[i]->getPosition().z) - (mDisplaySize * getScale()) / 2;
 				break;
 			}
 		}
@@ -4952,7 +5301,7 @@ protected:
 	virtual void mouseDrag(int x, int y)
 	{
 		glm::ivec2 diff = glm::ivec2(x, y) - mDragStart;
-		mDisplayOffset = mDragDisplayOffset - diff;
+		mDisplayOffset = mDragDisplayOffset - diff * getScale();
 	}
 
 public:
@@ -4984,17 +5333,17 @@ protected:
 			short slot = i + 1;
 			Item* item = playerBankItems.getItem(slot);
 
-			glColor4f(0.0f, 0.0f, 0.0f, item ? 0.75f : 0.25f);
+			Renderer::color4f(0.0f, 0.0f, 0.0f, item ? 0.75f : 0.25f);
 			Renderer::drawQuad2D(5 + (col * 52), 5 + (row * 52), 48, 48);
 			if (item)
 			{
-				glColor4f(1.0f, 1.0f, 1.0f, 0.25f);
+				Renderer::color4f(1.0f, 1.0f, 1.0f, 0.25f);
 				text(5 + (col * 52), 5 + (row * 52) + 13, RenderFont::BITMAP_8_BY_13, std::to_string(item->getItemId() / 1000000) + " - " + std::to_string(item->getItemId() % 1000000)); // debug
 
 				// show quantity for non-equips
 				if (item->getInventoryType() != InventoryType::EQUIP)
 				{
-					glColor3f(1.0f, 1.0f, 1.0f);
+					Renderer::color3f(1.0f, 1.0f, 1.0f);
 					std::string quantityStr = std::to_string(item->getQuantity());
 					text(5 + (col * 52) + 45 - Renderer::getStringWidth(RenderFont::BITMAP_HELVETICA_12, quantityStr), 5 + (row * 52) + 45, RenderFont::BITMAP_HELVETICA_12, quantityStr);
 				}
@@ -5003,10 +5352,10 @@ protected:
 				ItemInfo* info = ItemInformationProvider::getItemInfo(item->getItemId());
 				if (info)
 				{
-					glPushMatrix();
-					glTranslatef((float)(5 + (col * 52)), (float)(5 + (row * 52)), 0.0f);
+					Renderer::pushMatrix();
+					Renderer::translatef((float)(5 + (col * 52)), (float)(5 + (row * 52)), 0.0f);
 					info->drawIcon();
-					glPopMatrix();
+					Renderer::popMatrix();
 				}
 			}
 		}
@@ -5080,9 +5429,9 @@ protected:
 				if (item)
 				{
 					pushTransformMatrix();
-					glColor4f(0.25f, 0.25f, 0.25f, 0.9f);
+					Renderer::color4f(0.25f, 0.25f, 0.25f, 0.9f);
 					quad(curPos.x + 20, curPos.y + 20, 150, 80);
-					glColor3f(1.0f, 1.0f, 1.0f);
+					Renderer::color3f(1.0f, 1.0f, 1.0f);
 					ItemInfo* info = ItemInformationProvider::getItemInfo(item->getItemId());
 					if (info)
 					{
@@ -5175,17 +5524,17 @@ protected:
 			short slot = i + 1;
 			Item* item = playerCraftingItems.getItem(slot);
 
-			glColor4f(0.0f, 0.0f, 0.0f, item ? 0.75f : 0.25f);
+			Renderer::color4f(0.0f, 0.0f, 0.0f, item ? 0.75f : 0.25f);
 			Renderer::drawQuad2D(5 + (col * 52), 5 + (row * 52), 48, 48);
 			if (item)
 			{
-				glColor4f(1.0f, 1.0f, 1.0f, 0.25f);
+				Renderer::color4f(1.0f, 1.0f, 1.0f, 0.25f);
 				text(5 + (col * 52), 5 + (row * 52) + 13, RenderFont::BITMAP_8_BY_13, std::to_string(item->getItemId() / 1000000) + " - " + std::to_string(item->getItemId() % 1000000)); // debug
 
 				// show quantity for non-equips
 				if (item->getInventoryType() != InventoryType::EQUIP)
 				{
-					glColor3f(1.0f, 1.0f, 1.0f);
+					Renderer::color3f(1.0f, 1.0f, 1.0f);
 					std::string quantityStr = std::to_string(item->getQuantity());
 					text(5 + (col * 52) + 45 - Renderer::getStringWidth(RenderFont::BITMAP_HELVETICA_12, quantityStr), 5 + (row * 52) + 45, RenderFont::BITMAP_HELVETICA_12, quantityStr);
 				}
@@ -5194,15 +5543,15 @@ protected:
 				ItemInfo* info = ItemInformationProvider::getItemInfo(item->getItemId());
 				if (info)
 				{
-					glPushMatrix();
-					glTranslatef((float)(5 + (col * 52)), (float)(5 + (row * 52)), 0.0f);
+					Renderer::pushMatrix();
+					Renderer::translatef((float)(5 + (col * 52)), (float)(5 + (row * 52)), 0.0f);
 					info->drawIcon();
-					glPopMatrix();
+					Renderer::popMatrix();
 				}
 			}
 		}
 
-		glColor3f(0.0f, 0.0f, 0.0f);
+		Renderer::color3f(0.0f, 0.0f, 0.0f);
 		text(170, 85, RenderFont::BITMAP_HELVETICA_18, "->");
 
 		// show (potentially) crafted item
@@ -5213,7 +5562,7 @@ protected:
 		}
 		Item* craftedItem = mUsableRecipe ? mUsableRecipe->createItem() : 0;
 
-		glColor4f(0.0f, 0.0f, 0.0f, craftedItem ? 0.75f : 0.25f);
+		Renderer::color4f(0.0f, 0.0f, 0.0f, craftedItem ? 0.75f : 0.25f);
 		Renderer::drawQuad2D(200, 57, 48, 48);
 
 		if (craftedItem)
@@ -5221,7 +5570,7 @@ protected:
 			// show quantity for non-equips
 			if (craftedItem->getInventoryType() != InventoryType::EQUIP)
 			{
-				glColor3f(1.0f, 1.0f, 1.0f);
+				Renderer::color3f(1.0f, 1.0f, 1.0f);
 				std::string quantityStr = std::to_string(craftedItem->getQuantity());
 				text(200 + 45 - Renderer::getStringWidth(RenderFont::BITMAP_HELVETICA_12, quantityStr), 57 + 45, RenderFont::BITMAP_HELVETICA_12, quantityStr);
 			}
@@ -5230,10 +5579,10 @@ protected:
 			ItemInfo* info = ItemInformationProvider::getItemInfo(craftedItem->getItemId());
 			if (info)
 			{
-				glPushMatrix();
-				glTranslatef((float)200, (float)57, 0.0f);
+				Renderer::pushMatrix();
+				Renderer::translatef((float)200, (float)57, 0.0f);
 				info->drawIcon();
-				glPopMatrix();
+				Renderer::popMatrix();
 			}
 		}
 
@@ -5350,6 +5699,7 @@ class ISkillEffect
 public:
 	virtual void update(float elapsed) = 0;
 	virtual void draw() = 0;
+	virtual glm::vec3 getCenter() = 0;
 	virtual bool completed() = 0;
 };
 
@@ -5380,7 +5730,7 @@ public:
 
 		// draw ray
 		glLineWidth(10.0f);
-		glColor4f(Renderer::BYTE_TO_FLOAT_COLOR(225), Renderer::BYTE_TO_FLOAT_COLOR(144), Renderer::BYTE_TO_FLOAT_COLOR(255), alpha);
+		Renderer::color4f(Renderer::BYTE_TO_FLOAT_COLOR(225), Renderer::BYTE_TO_FLOAT_COLOR(144), Renderer::BYTE_TO_FLOAT_COLOR(255), alpha);
 		glBegin(GL_LINES);
 		glVertex3f(mStartPoint.x, mStartPoint.y, mStartPoint.z);
 		glVertex3f(mEndPoint.x, mEndPoint.y, mEndPoint.z);
@@ -5388,6 +5738,7 @@ public:
 		glLineWidth(1.0f);
 	}
 
+	virtual glm::vec3 getCenter() { return (mStartPoint + mEndPoint) * 0.5f; }
 	virtual bool completed() { return mTimeDisplayed >= 2.0f; }
 };
 
@@ -5569,7 +5920,7 @@ public:
 
 		// draw ray
 		glLineWidth(10.0f);
-		glColor4f(Renderer::BYTE_TO_FLOAT_COLOR(146), Renderer::BYTE_TO_FLOAT_COLOR(144), Renderer::BYTE_TO_FLOAT_COLOR(56), alpha);
+		Renderer::color4f(Renderer::BYTE_TO_FLOAT_COLOR(146), Renderer::BYTE_TO_FLOAT_COLOR(144), Renderer::BYTE_TO_FLOAT_COLOR(56), alpha);
 		glBegin(GL_LINES);
 		glVertex3f(mStartPoint.x, mStartPoint.y, mStartPoint.z);
 		glVertex3f(mEndPoint.x, mEndPoint.y, mEndPoint.z);
@@ -5577,6 +5928,7 @@ public:
 		glLineWidth(1.0f);
 	}
 
+	virtual glm::vec3 getCenter() { return (mStartPoint + mEndPoint) * 0.5f; }
 	virtual bool completed() { return mTimeDisplayed >= 0.5f; }
 };
 
@@ -5668,175 +6020,185 @@ public:
 
 PerlinNoise noise;
 
-bool operator >= (const glm::ivec3& v1, const glm::ivec3& v2) { return v1.x >= v2.x && v1.y >= v2.y && v1.z >= v2.z; }
-bool operator <= (const glm::ivec3& v1, const glm::ivec3& v2) { return v1.x <= v2.x && v1.y <= v2.y && v1.z <= v2.z; }
+enum class TreeType
+{
+	OAK, // light green leaves, light brown trunk
+	BIRCH, // light green leaves, white trunk
+	SPRUCE, // dark green leaves, dark brown trunk
+	JUNGLE // medium green leaves, yellow-brown trunk
+};
+
+const int TREE_TYPE_COUNT = 3; // don't use jungle for now
+const int TREE_VARIANTS = 16; // stamps per tree type
 
-// i think the effected chunks system should be designed a little better and this should extend a multi-purpose chunk modifier class or something, but it works
-class TerrainTree
+// by type, then variant
+std::vector<std::unique_ptr<StructureStamp>> treeStamps;
+
+glm::ivec3 getTreeTrunkColor(TreeType type)
 {
-private:
-	glm::ivec3 position;
-	int height;
-	glm::ivec3 shape;
-	int levels;
-	enum class Type
+	glm::ivec3 trunkColor;
+	if (type == TreeType::OAK)
 	{
-		OAK, // light green leaves, light brown trunk
-		BIRCH, // light green leaves, white trunk
-		SPRUCE, // dark green leaves, dark brown trunk
-		JUNGLE // medium green leaves, yellow-brown trunk
-	};
-	Type type;
-	std::vector<glm::ivec3> effectedChunks;
-	std::vector<glm::ivec3> loadedChunks;
-	std::vector<glm::ivec3> unloadedChunks;
-
-	glm::ivec3 getTrunkColor()
+		trunkColor.r = 137;
+		trunkColor.g = Randomizer::getRandomInt(30, 90);
+		trunkColor.b = 0;
+	}
+	else if (type == TreeType::BIRCH)
 	{
-		glm::ivec3 trunkColor;
-		if (type == Type::OAK)
-		{
-			trunkColor.r = 137;
-			trunkColor.g = Randomizer::getRandomInt(30, 90);
-			trunkColor.b = 0;
-		}
-		else if (type == Type::BIRCH)
-		{
-			trunkColor.r = Randomizer::getRandomInt(110, 130);
-			trunkColor.g = Randomizer::getRandomInt(110, 130);
-			trunkColor.b = Randomizer::getRandomInt(110, 130);
-		}
-		else if (type == Type::SPRUCE)
-		{
-			trunkColor.r = 127;
-			trunkColor.g = Randomizer::getRandomInt(15, 50);
-			trunkColor.b = 25;
-		}
-		return trunkColor;
+		trunkColor.r = Randomizer::getRandomInt(110, 130);
+		trunkColor.g = Randomizer::getRandomInt(110, 130);
+		trunkColor.b = Randomizer::getRandomInt(110, 130);
 	}
-
-	glm::ivec3 getLeavesColor()
+	else if (type == TreeType::SPRUCE)
 	{
-		glm::ivec3 leavesColor;
-		if (type == Type::OAK)
-		{
-			leavesColor.r = Randomizer::getRandomInt(100, 135);
-			leavesColor.g = Randomizer::getRandomInt(100, 135);
-			leavesColor.b = 0;
-		}
-		else if (type == Type::BIRCH)
-		{
-			leavesColor.r = Randomizer::getRandomInt(140, 165);
-			leavesColor.g = Randomizer::getRandomInt(140, 165);
-			leavesColor.b = 0;
-		}
-		else if (type == Type::SPRUCE)
-		{
-			leavesColor.r = Randomizer::getRandomInt(50, 80);
-			leavesColor.g = Randomizer::getRandomInt(50, 80);
-			leavesColor.b = 0;
-		}
-		return leavesColor;
+		trunkColor.r = 127;
+		trunkColor.g = Randomizer::getRandomInt(15, 50);
+		trunkColor.b = 25;
 	}
+	return trunkColor;
+}
 
-public:
-	TerrainTree(int x, int y, int z)
-	{
-		position = glm::ivec3(x, y, z);
-		height = Randomizer::getRandomInt(4, 8);
-		shape = glm::ivec3(Randomizer::getRandomInt(2, 7), Randomizer::getRandomInt(1, height / 2), Randomizer::getRandomInt(2, 7));
-		levels = Randomizer::getRandomInt(1, 4);
-		type = (Type)Randomizer::getRandomInt(0, 2); // don't use jungle for now
-
-		// calculate relevant chunks
-		glm::ivec3 chunkStart(getVoxelChunkPos(x, y, z));
-		// TODO: this technically doesn't consider x/z offsets on y axis when height overflows. invisible because of current usage contexts
-		effectedChunks.push_back(chunkStart);
-		//if (position.y + height + shape.y > chunkStart.y + 16) { effectedChunks.push_back(glm::ivec3(x, y + 1, z)); }
-		for (int i = 0; i < levels; i++) // not exactly perfect, but overshooting it a little is ok, undershooting it means malformation
-		{
-			if (position.x - shape.x < chunkStart.x) { effectedChunks.push_back(glm::ivec3(chunkStart.x - 1, chunkStart.y + i, chunkStart.z)); }
-			if (position.x + shape.x > chunkStart.x + 16) { effectedChunks.push_back(glm::ivec3(chunkStart.x + 1, chunkStart.y + i, chunkStart.z)); }
-			if (position.z - shape.z < chunkStart.z) { effectedChunks.push_back(glm::ivec3(chunkStart.x, chunkStart.y + i, chunkStart.z - 1)); }
-			if (position.z + shape.z > chunkStart.z + 16) { effectedChunks.push_back(glm::ivec3(chunkStart.x, chunkStart.y + i, chunkStart.z + 1)); }
-		}
-		
-		// mark all effected chunks as unloaded
-		for (auto it : effectedChunks) { unloadedChunks.push_back(it); }
+glm::ivec3 getTreeLeavesColor(TreeType type)
+{
+	glm::ivec3 leavesColor;
+	if (type == TreeType::OAK)
+	{
+		leavesColor.r = Randomizer::getRandomInt(100, 135);
+		leavesColor.g = Randomizer::getRandomInt(100, 135);
+		leavesColor.b = 0;
+	}
+	else if (type == TreeType::BIRCH)
+	{
+		leavesColor.r = Randomizer::getRandomInt(140, 165);
+		leavesColor.g = Randomizer::getRandomInt(140, 165);
+		leavesColor.b = 0;
+	}
+	else if (type == TreeType::SPRUCE)
+	{
+		leavesColor.r = Randomizer::getRandomInt(50, 80);
+		leavesColor.g = Randomizer::getRandomInt(50, 80);
+		leavesColor.b = 0;
 	}
+	return leavesColor;
+}
 
-	void loadChunk(int x, int y, int z)
+// dense box for building a stamp voxel by voxel
+struct StampBox
+{
+	glm::ivec3 mLower;
+	glm::ivec3 mSize;
+	std::vector<StampVoxel> mVoxels;
+
+	StampBox(const glm::ivec3& lower, const glm::ivec3& size) : mLower(lower), mSize(size), mVoxels((size_t)size.x * size.y * size.z, StampVoxel{ 0, 0, 0, 0 }) {}
+
+	void set(int x, int y, int z, const glm::ivec3& clr)
 	{
-		// check if this is an unloaded chunk
-		bool doLoad = false;
-		unsigned int i = 0;
-		for (i = 0; i < unloadedChunks.size(); i++)
-		{
-			const glm::ivec3& vec = unloadedChunks[i];
-			if (vec.x == x && vec.y == y && vec.z == z)
-			{
-				doLoad = true;
-				break;
-			}
-		}
+		StampVoxel& voxel = mVoxels[(x - mLower.x) + ((y - mLower.y) + (z - mLower.z) * mSize.y) * mSize.x];
+		voxel = StampVoxel{ (unsigned char)clr.r, (unsigned char)clr.g, (unsigned char)clr.b, 255 };
+	}
 
-		// draw relevant portion in this chunk, only if unloaded
-		if (!doLoad) { return; }
+	StructureStamp* build() { return new StructureStamp(mLower, mSize, mVoxels); }
+};
 
-		glm::ivec3 chunkStart(x * 16, y * 16, z * 16);
-		glm::ivec3 chunkEnd(16, 16, 16);
-		chunkEnd += chunkStart;
+// a trunk at the origin with levels of leaves above it, each narrower than the one below
+StructureStamp* buildTreeStamp(TreeType type, int variant)
+{
+	Randomizer::SeededScope seeded(RandomPurpose::STRUCTURE_TEMPLATE, 0, (int)type, variant);
+	int height = Randomizer::getRandomInt(4, 8);
+	glm::ivec3 shape(Randomizer::getRandomInt(2, 7), Randomizer::getRandomInt(1, height / 2), Randomizer::getRandomInt(2, 7));
+	int levels = Randomizer::getRandomInt(1, 4);
 
-		// trunk
-		if (position >= chunkStart && position <= chunkEnd)
-		{
-			for (int i = 0; i < height; i++) { setVoxel(position.x, position.y + i, position.z, getTrunkColor()); }
-		}
-		// leaves
-		for (int ll = 0; ll < levels; ll++)
+	StampBox box(glm::ivec3(-shape.x, 0, -shape.z), glm::ivec3(shape.x * 2 + 1, height + shape.y * (levels * 2 - 1) + 1, shape.z * 2 + 1));
+	for (int i = 0; i < height; i++) { box.set(0, i, 0, getTreeTrunkColor(type)); }
+	for (int ll = 0; ll < levels; ll++)
+	{
+		int tier = ll + 1;
+		for (int xx = -(shape.x / tier); xx <= shape.x / tier; xx++)
 		{
-			int tier = ll + 1;
-			for (int xx = position.x - (shape.x / tier); xx <= position.x + (shape.x / tier); xx++)
+			for (int yy = -shape.y; yy <= shape.y; yy++)
 			{
-				for (int yy = position.y - shape.y; yy <= position.y + shape.y; yy++)
+				for (int zz = -(shape.z / tier); zz <= shape.z / tier; zz++)
 				{
-					for (int zz = position.z - (shape.z / tier); zz <= position.z + (shape.z / tier); zz++)
-					{
-						glm::ivec3 curPos(xx, yy, zz);
-						if (curPos >= chunkStart && curPos <= chunkEnd)
-						{
-							if (Randomizer::getRandomInt(1, 10) >= 3)
-							{
-								setVoxel(curPos.x, curPos.y + height + (shape.y * ll * 2), curPos.z, getLeavesColor());
-							}
-						}
-					}
+					if (Randomizer::getRandomInt(1, 10) >= 3) { box.set(xx, yy + height + (shape.y * ll * 2), zz, getTreeLeavesColor(type)); }
 				}
 			}
 		}
-
-		// mark as loaded
-		unloadedChunks.erase(unloadedChunks.begin() + i);
-		loadedChunks.push_back(glm::ivec3(x, y, z));
 	}
+	return box.build();
+}
 
-	bool isLoaded() { return loadedChunks.size() == effectedChunks.size(); }
-};
+// which tree grows only depends on where its trunk is
+const StructureStamp* getTreeStamp(int x, int y, int z)
+{
+	Randomizer::SeededScope seeded(RandomPurpose::TREE, x, y, z);
+	int type = Randomizer::getRandomInt(0, TREE_TYPE_COUNT - 1);
+	int variant = Randomizer::getRandomInt(0, TREE_VARIANTS - 1);
+	return treeStamps[type * TREE_VARIANTS + variant].get();
+}
 
-std::vector<std::unique_ptr<TerrainTree>> trees;
+// structures waiting for chunks that don't exist yet or are being generated
+StructurePlacementTable structurePlacements;
 
-// TODO: this system should be turned into an IChunkLoadListener architecture, functioning like an onLoad hook. saves lots of unnecessary iteration
-void loadTreeVoxelsForChunk(int x, int y, int z)
+// copies the part of a placed structure inside the chunk at pos into a volume, placed being the structures copied into it
+// so far. where structures overlap the last one in placement order wins, so the chunk comes out the same whichever
+// order its neighbours were decorated in
+void copyStructureSlice(VoxelVolume* volume, const glm::ivec3& pos, const StructurePlacement& placement, std::vector<StructurePlacement>& placed)
 {
-	for (auto it = trees.begin(); it != trees.end(); )
+	forEachUncoveredSpan(placement, placed, pos * 16, pos * 16 + 15, [volume](const glm::ivec3& start, const StampVoxel* voxels, int count)
 	{
-		it->get()->loadChunk(x, y, z);
-		if (it->get()->isLoaded()) { it = trees.erase(it); }
-		else { it++; }
-	}
+		volume->setVoxelRun(start.x, start.y, start.z, voxels, count);
+	});
+	placed.push_back(placement);
 }
 
-void setTree(int x, int y, int z) { trees.push_back(std::unique_ptr<TerrainTree>(new TerrainTree(x, y, z))); }
+// the same for a chunk in the world, which also keeps its heightmap up to date
+void copyStructureSlice(VolumeChunk* chunk, const glm::ivec3& pos, const StructurePlacement& placement)
+{
+	VoxelVolume* volume = chunk->mVolume.get();
+	forEachUncoveredSpan(placement, chunk->mStructures, pos * 16, pos * 16 + 15, [volume, &pos](const glm::ivec3& start, const StampVoxel* voxels, int count)
+	{
+		volume->setVoxelRun(start.x, start.y, start.z, voxels, count);
+		for (int i = 0; i < count; i++) { setHeightmapVoxel(pos, start.x + i, start.y, start.z, VoxelType(voxels[i].r, voxels[i].g, voxels[i].b, voxels[i].a)); }
+	});
+	chunk->mStructures.push_back(placement);
+	chunk->mMeshNeedsUpdate = true;
+}
+
+// copies everything waiting for the chunk at pos into it, if it is in the world with its terrain
+void copyPendingStructures(const glm::ivec3& pos)
+{
+	auto it = mChunks.find(pos);
+	if (it == mChunks.end() || it->second->mNeedsRegeneration) { return; }
+
+	VolumeChunk* chunk = it->second.get();
+	for (auto& placement : structurePlacements.take(pos)) { copyStructureSlice(chunk, pos, placement); }
+}
+
+// copies a structure into the chunks it reaches that are in the world, the others get it once they are generated
+void placeStructure(const StructureStamp* stamp, const glm::ivec3& origin)
+{
+	StructurePlacement placement = { stamp, origin };
+	std::vector<glm::ivec3> chunks;
+	StructurePlacementTable::getChunks(placement, chunks);
+	for (auto& pos : chunks)
+	{
+		structurePlacements.add(pos, placement);
+		copyPendingStructures(pos);
+	}
+}
+
+// fills in structures once the chunks they reach are created or generated
+class StructurePlacementListener : public IChunkEventListener
+{
+public:
+	virtual void onChunkEvent(ChunkEvent event, const glm::ivec3& pos, VolumeChunk* chunk)
+	{
+		// regenerating chunks get filled once the new terrain is in
+		if (!chunk->mNeedsRegeneration) { copyPendingStructures(pos); }
+	}
+} structurePlacementListener;
+
+void setTree(int x, int y, int z) { placeStructure(getTreeStamp(x, y, z), glm::ivec3(x, y, z)); }
 
 class VisibleRegionBorder
 {
@@ -5856,9 +6218,25 @@ public:
 		clr.a = a;
 	}
 
+	// borders usually surround the camera, so the closest wall is what decides their draw order
+	glm::vec3 getNearestWallPoint(const glm::vec3& from)
+	{
+		glm::vec3 ret(glm::clamp(from.x, pos.x, pos.x + size.x), from.y, glm::clamp(from.z, pos.z, pos.z + size.z));
+		if (ret.x != from.x || ret.z != from.z) { return ret; }
+
+		float toLowX = from.x - pos.x, toHighX = pos.x + size.x - from.x;
+		float toLowZ = from.z - pos.z, toHighZ = pos.z + size.z - from.z;
+		float nearest = std::min(std::min(toLowX, toHighX), std::min(toLowZ, toHighZ));
+		if (nearest == toLowX) { ret.x = pos.x; }
+		else if (nearest == toHighX) { ret.x = pos.x + size.x; }
+		else if (nearest == toLowZ) { ret.z = pos.z; }
+		else { ret.z = pos.z + size.z; }
+		return ret;
+	}
+
 	void draw()
 	{
-		glColor4f(clr.r, clr.g, clr.b, clr.a);
+		Renderer::color4f(clr.r, clr.g, clr.b, clr.a);
 
 		glBegin(GL_QUADS);
 
@@ -5896,153 +6274,95 @@ std::vector<std::unique_ptr<VisibleRegionBorder>> visibleRegionBorders;
 
 void addVisibleRegionBorder(VisibleRegionBorder* border) { visibleRegionBorders.push_back(std::unique_ptr<VisibleRegionBorder>(border)); }
 
-class Dungeon
+// the pieces a dungeon cell is built from. the walls are in the order of MazeWall
+enum class DungeonPiece
 {
-private:
-	glm::ivec3 mPosition;
-	glm::ivec3 mSize;
-	bool mActivatable = true;
-	bool mActivated = false;
-
-	bool mazeWalls[57][57][4];
-	glm::ivec2 mazeCurPos;
-	int mazeMoveLimit = 300;
-	std::vector<glm::ivec2> mazeClearedTiles;
-
-	enum class MazeWall
-	{
-		FORWARD,
-		RIGHT,
-		BACKWARD,
-		LEFT,
-		INVALID
-	};
-
-	void mazeInitWalls()
-	{
-		for (int w = 0; w < 57; w++)
-		{
-			for (int d = 0; d < 57; d++)
-			{
-				for (int i = 0; i < 4; i++)
-				{
-					mazeWalls[w][d][i] = true;
-				}
-			}
-		}
-	}
-
-	void mazeRemoveWall(MazeWall dir) { mazeWalls[mazeCurPos.x][mazeCurPos.y][(int)dir] = false; }
-
-	bool mazeCanMove(MazeWall dir)
-	{
-		return !(dir == MazeWall::FORWARD && mazeCurPos.y + 1 > 56 ||
-			dir == MazeWall::RIGHT && mazeCurPos.x + 1 > 56 ||
-			dir == MazeWall::BACKWARD && mazeCurPos.y - 1 < 0 ||
-			dir == MazeWall::LEFT && mazeCurPos.x - 1 < 0);
-	}
+	FLOOR, // under the whole cell
+	WALL_FORWARD,
+	WALL_RIGHT,
+	WALL_BACKWARD,
+	WALL_LEFT,
+	CORE // fills completely walled off cells
+};
 
-	void mazeMoveDirection(MazeWall dir)
-	{
-		if (dir == MazeWall::FORWARD) { mazeCurPos.y++; }
-		else if (dir == MazeWall::RIGHT) { mazeCurPos.x++; }
-		else if (dir == MazeWall::BACKWARD) { mazeCurPos.y--; }
-		else if (dir == MazeWall::LEFT) { mazeCurPos.x--; }
-	}
+const int DUNGEON_PIECE_COUNT = 6;
+const int DUNGEON_THEME_COUNT = 3; // theme ids start at 1
+const int DUNGEON_PIECE_VARIANTS = 4; // stamps per piece and theme
 
-	MazeWall mazeGetInverseWall(MazeWall dir)
-	{
-		if (dir == MazeWall::FORWARD) { return MazeWall::BACKWARD; }
-		else if (dir == MazeWall::RIGHT) { return MazeWall::LEFT; }
-		else if (dir == MazeWall::BACKWARD) { return MazeWall::FORWARD; }
-		else if (dir == MazeWall::LEFT) { return MazeWall::RIGHT; }
-		else { return MazeWall::INVALID; }
-	}
+// by theme, then piece, then variant
+std::vector<std::unique_ptr<StructureStamp>> dungeonStamps;
 
-	bool mazeClearPath(MazeWall dir)
-	{
-		if (!mazeCanMove(dir)) { return false; }
-
-		mazeRemoveWall(dir);
-		mazeMoveDirection(dir);
-		mazeRemoveWall(mazeGetInverseWall(dir));
-		mazeClearedTiles.push_back(mazeCurPos);
+// the cell's corner is the origin, except for the floor which lies one below it
+StructureStamp* buildDungeonStamp(int themeId, DungeonPiece piece, int variant)
+{
+	Randomizer::SeededScope seeded(RandomPurpose::STRUCTURE_TEMPLATE, 1 + (int)piece, themeId, variant);
 
-		return true;
-	}
+	glm::ivec3 lower(0);
+	glm::ivec3 size(16, 1, 16);
+	if (piece == DungeonPiece::WALL_FORWARD) { lower.z = 15; size.z = 1; }
+	else if (piece == DungeonPiece::WALL_BACKWARD) { size.z = 1; }
+	else if (piece == DungeonPiece::WALL_RIGHT) { lower.x = 15; size.x = 1; }
+	else if (piece == DungeonPiece::WALL_LEFT) { size.x = 1; }
+	else if (piece == DungeonPiece::CORE) { lower = glm::ivec3(1, 0, 1); size = glm::ivec3(14, 1, 14); }
 
-	void mazeGenerate()
+	StampBox box(lower, size);
+	for (int x = lower.x; x < lower.x + size.x; x++)
 	{
-		mazeInitWalls();
-		MazeWall lastDirection = MazeWall::INVALID;
-		for (int curMoves = 0; curMoves < mazeMoveLimit; curMoves++)
+		for (int z = lower.z; z < lower.z + size.z; z++)
 		{
-			MazeWall direction = (MazeWall)Randomizer::getRandomInt(0, 3);
-			if (lastDirection != MazeWall::INVALID)
+			glm::ivec3 clr;
+			if (piece == DungeonPiece::FLOOR)
 			{
-				// don't just go forwards and backwards, and don't attempt a move we just confirmed is invalid either
-				while (direction == mazeGetInverseWall(lastDirection) || !mazeCanMove(direction))
-				{
-					if (direction == mazeGetInverseWall(lastDirection))
-					{
-						printf("%d is inverse %d! regen\n", direction, lastDirection);
-					}
-					else if (!mazeCanMove(direction))
-					{
-						printf("can't move in dir %d! regen\n", direction);
-					}
-					else
-					{
-						printf("UNKOWN MAZE ERROR!\n");
-					}
-					direction = (MazeWall)Randomizer::getRandomInt(0, 3);
-				}
+				clr.r = Randomizer::getRandomInt(themeId == 2 ? 100 : 0, themeId == 2 ? 255 : 30);
+				clr.g = Randomizer::getRandomInt(themeId == 1 ? 100 : 0, themeId == 1 ? 255 : 30);
+				clr.b = Randomizer::getRandomInt(themeId == 3 ? 100 : 0, themeId == 3 ? 255 : 30);
 			}
-			int len = Randomizer::getRandomInt(2, 8);
-
-			for (int i = 0; i < len; i++)
+			else
 			{
-				if (!mazeClearPath(direction))
-				{
-					printf("Hit map bound\n");
-					break;
-				}
+				clr.r = Randomizer::getRandomInt(0, themeId == 2 ? 75 : 15);
+				clr.g = Randomizer::getRandomInt(0, themeId == 1 ? 75 : 15);
+				clr.b = Randomizer::getRandomInt(0, themeId == 3 ? 75 : 15);
 			}
-
-			lastDirection = direction;
-			printf("Completed maze move %d\n", curMoves);
+			box.set(x, 0, z, clr);
 		}
 	}
+	return box.build();
+}
 
-	void setWallVoxel(int x, int y, int z)
-	{
-		setVoxel(x, y, z,
-			Randomizer::getRandomInt(0, mThemeId == 2 ? 75 : 15),
-			Randomizer::getRandomInt(0, mThemeId == 1 ? 75 : 15),
-			Randomizer::getRandomInt(0, mThemeId == 3 ? 75 : 15)
-		);
-	}
+const StructureStamp* getDungeonStamp(int themeId, DungeonPiece piece, int variant) { return dungeonStamps[((themeId - 1) * DUNGEON_PIECE_COUNT + (int)piece) * DUNGEON_PIECE_VARIANTS + variant].get(); }
 
-	void setFloorVoxel(int x, int y, int z)
+// builds every tree and dungeon stamp, their looks follow from the world seed
+void buildStructureStamps()
+{
+	treeStamps.clear();
+	for (int type = 0; type < TREE_TYPE_COUNT; type++)
 	{
-		setVoxel(x, y, z,
-			Randomizer::getRandomInt(mThemeId == 2 ? 100 : 0, mThemeId == 2 ? 255 : 30),
-			Randomizer::getRandomInt(mThemeId == 1 ? 100 : 0, mThemeId == 1 ? 255 : 30),
-			Randomizer::getRandomInt(mThemeId == 3 ? 100 : 0, mThemeId == 3 ? 255 : 30)
-		);
+		for (int variant = 0; variant < TREE_VARIANTS; variant++) { treeStamps.push_back(std::unique_ptr<StructureStamp>(buildTreeStamp((TreeType)type, variant))); }
 	}
 
-	void generateMazeWallVoxels(int baseX, int baseZ, MazeWall wall)
+	dungeonStamps.clear();
+	for (int themeId = 1; themeId <= DUNGEON_THEME_COUNT; themeId++)
 	{
-		for (int i = 0; i < 16; i++)
+		for (int piece = 0; piece < DUNGEON_PIECE_COUNT; piece++)
 		{
-			setWallVoxel(
-				baseX + (wall == MazeWall::FORWARD || wall == MazeWall::BACKWARD ? i : 0) + (wall == MazeWall::RIGHT ? 15 : 0),
-				0,
-				baseZ + (wall == MazeWall::LEFT || wall == MazeWall::RIGHT ? i : 0) + (wall == MazeWall::FORWARD ? 15 : 0)
-			);
+			for (int variant = 0; variant < DUNGEON_PIECE_VARIANTS; variant++) { dungeonStamps.push_back(std::unique_ptr<StructureStamp>(buildDungeonStamp(themeId, (DungeonPiece)piece, variant))); }
 		}
 	}
+}
+
+// how dungeon mazes are carved, see -maze
+MazeGenerator dungeonMazeGenerator = MazeGenerator::RANDOM_WALK;
+
+class Dungeon
+{
+private:
+	glm::ivec3 mPosition;
+	glm::ivec3 mSize;
+	bool mActivatable = true;
+	bool mActivated = false;
+
+	DungeonMaze mMaze; // carved on a worker, nothing reads it until mMazeReady
+	bool mMazeReady = false;
 
 	class DungeonEnemyMovementController : public IEnemyMovementController
 	{
@@ -6052,12 +6372,9 @@ private:
 	public:
 		DungeonEnemyMovementController(Dungeon* dungeon) : mDungeon(dungeon) {}
 
-		virtual bool invalidPathfindNode(const glm::ivec2& node)
-		{
-			if (node.x < 0 || node.y < 0 || node.x >= 57 || node.y >= 57) { return true; }
-			if (mDungeon->mazeWalls[node.x][node.y][0] && mDungeon->mazeWalls[node.x][node.y][1] && mDungeon->mazeWalls[node.x][node.y][2] && mDungeon->mazeWalls[node.x][node.y][3]) { return true; }
-			return false;
-		}
+		virtual bool invalidPathfindNode(const glm::ivec2& node) { return !mDungeon->mMaze.isWalkable(node); }
+
+		virtual bool blockedPathfindStep(const glm::ivec2& from, const glm::ivec2& to) { return !mDungeon->mMaze.canStep(from, to); }
 
 		virtual glm::ivec2 worldToMazePos(const glm::vec3& worldPos) { return glm::ivec2((int)std::floorf((worldPos.x - mDungeon->mPosition.x) / 16.0f), (int)std::floorf((worldPos.z - mDungeon->mPosition.z) / 16.0f)); }
 
@@ -6076,24 +6393,15 @@ public:
 	{
 		mMovementController.reset(new DungeonEnemyMovementController(this));
 
-		// generate and apply pathing
-		mazeCurPos = glm::ivec2(randomNumber(0, 56), randomNumber(0, 56));
-		mazeClearedTiles.push_back(mazeCurPos);
-		//cx = (float)mPosition.x + (float)(mazeCurPos.x * 7) + 4;
-		//cz = (float)mPosition.z + (float)(mazeCurPos.y * 7) + 4;
-		mazeGenerate();
-
-		// load spawnpoints
-		if (mazeClearedTiles.size() > 3)
+		// the maze is carved on a worker so spawning a dungeon doesn't hold up the frame, its chunks wait until it is done
+		uint64_t seed = Randomizer::getStreamKey(RandomPurpose::DUNGEON, x, 0, z);
+		MazeGenerator generator = dungeonMazeGenerator;
+		JobHandle job = JobSystem::submit([this, generator, seed]() { mMaze.generate(generator, seed); });
+		JobSystem::thenOnMainThread(job, [this, seed]()
 		{
-			for (int i = 0; i < 10; i++)
-			{
-				glm::ivec2 pos = mazeClearedTiles[Randomizer::getRandomInt(3, mazeClearedTiles.size() - 1)];
-				// TODO: currently assumes mobId == themeId. needs flexibility.
-				spawnPoints.push_back(std::unique_ptr<EnemySpawnPoint>(new EnemySpawnPoint(glm::vec3(mPosition.x + (pos.x * 16) + 3, 0.0f, mPosition.z + (pos.y * 16) + 3), mMovementController.get(), mThemeId)));
-			}
-		}
-		else { printf("[WARN] Dungeon generated with less than 3 cleared tiles!\n"); }
+			mMazeReady = true;
+			loadSpawnPoints(seed);
+		});
 
 		// add wave enter npc
 		//loadNPC(2, glm::vec3(cx - 3, 0, cz - 3));
@@ -6107,12 +6415,34 @@ public:
 		setActivated(false);
 	}
 
-	bool usesChunk(int x, int y, int z)
+	// the chunk columns the dungeon covers, inclusive
+	void getChunkFootprint(glm::ivec2& lower, glm::ivec2& upper)
 	{
 		glm::ivec3 chunkStart(getVoxelChunkPos(mPosition.x, mPosition.y, mPosition.z));
 		glm::ivec3 chunkEnd(getVoxelChunkPos(mPosition.x + (mSize.x * 16), mPosition.y + (mSize.x * 16), mPosition.z + (mSize.x * 16)));
+		lower = glm::ivec2(chunkStart.x, chunkStart.z);
+		upper = glm::ivec2(chunkEnd.x - 1, chunkEnd.z - 1);
+	}
+
+	void loadSpawnPoints(uint64_t seed)
+	{
+		if (mMaze.getSpawnTileCount() == 0) { printf("[WARN] Dungeon generated without spawn tiles!\n"); return; }
+
+		Randomizer::SeededScope seeded(Randomizer::getStreamKey(seed, 1, 0, 0));
+		for (int i = 0; i < 10; i++)
+		{
+			glm::ivec2 pos = mMaze.getSpawnTile(Randomizer::getRandomInt(0, mMaze.getSpawnTileCount() - 1));
+			// TODO: currently assumes mobId == themeId. needs flexibility.
+			spawnPoints.push_back(std::unique_ptr<EnemySpawnPoint>(new EnemySpawnPoint(glm::vec3(mPosition.x + (pos.x * 16) + 3, 0.0f, mPosition.z + (pos.y * 16) + 3), mMovementController.get(), mThemeId)));
+		}
+	}
+
+	bool usesChunk(int x, int y, int z)
+	{
+		glm::ivec2 lower, upper;
+		getChunkFootprint(lower, upper);
 
-		if (x >= chunkStart.x && x < chunkEnd.x && z >= chunkStart.z && z < chunkEnd.z) { return true; }
+		if (x >= lower.x && x <= upper.x && z >= lower.y && z <= upper.y) { return true; }
 		return false;
 	}
 
@@ -6127,6 +6457,7 @@ public:
 		return AxisAlignedBoundingBox(startPos, startPos + worldSize);
 	}
 
+	bool isMazeReady() const { return mMazeReady; }
 	const bool& isActivatable() const { return mActivatable; }
 	void setActivatable(bool a) { mActivatable = a; }
 	void setActivated(bool activated)
@@ -6135,43 +6466,43 @@ public:
 		mVisibleBorder->setColor(mActivated ? 1.0f : 0.0f, 0.2f, mActivated ? 0.0f : 1.0f, 0.75f);
 	}
 
-	void loadChunk(int x, int y, int z)
+	// the pieces a dungeon chunk is built from, and the tree of a walled in cell. only depends on the maze, so it can be
+	// run without a dungeon in the world
+	static void getChunkPieces(const DungeonMaze& maze, int themeId, const glm::ivec2& cell, const glm::ivec3& chunkPos, std::vector<StructurePlacement>& pieces)
 	{
-		if (y != 0) { return; }
-
-		glm::ivec3 chunkStart(x * 16, y * 16, z * 16);
-
-		// base terrain floor (light grass)
-		for (int x = 0; x < 16; x++)
+		Randomizer::SeededScope seeded(RandomPurpose::DUNGEON_CHUNK, chunkPos.x, chunkPos.y, chunkPos.z);
+		glm::ivec3 chunkStart(chunkPos * 16);
+		auto addPiece = [themeId, &chunkStart, &pieces](DungeonPiece piece, int y)
 		{
-			for (int z = 0; z < 16; z++)
-			{
-				setFloorVoxel(chunkStart.x + x, -1, chunkStart.z + z);
-				//if (x == -200 || x == 200 || z == -200 || z == 200) { setVoxel(x, 0, z, randomNumber(0, 15), randomNumber(0, 75), randomNumber(0, 15)); }
-			}
-		}
+			StructurePlacement placement = { getDungeonStamp(themeId, piece, Randomizer::getRandomInt(0, DUNGEON_PIECE_VARIANTS - 1)), glm::ivec3(chunkStart.x, y, chunkStart.z) };
+			pieces.push_back(placement);
+		};
 
-		// walls
-		int cellX = x - (mPosition.x / 16);
-		int cellZ = z - (mPosition.z / 16);
+		// base terrain floor (light grass)
+		addPiece(DungeonPiece::FLOOR, -1);
 
 		// place walls on voxel terrain for each walled off direction of the cell
-		for (int wall = 0; wall < 4; wall++) { if (mazeWalls[cellX][cellZ][wall]) { generateMazeWallVoxels(chunkStart.x, chunkStart.z, (MazeWall)wall); } }
+		for (int wall = 0; wall < 4; wall++) { if (maze.hasWall(cell.x, cell.y, (MazeWall)wall)) { addPiece((DungeonPiece)((int)DungeonPiece::WALL_FORWARD + wall), 0); } }
 
 		// fill in the center of completely walled off cells
-		if (mazeWalls[cellX][cellZ][0] && mazeWalls[cellX][cellZ][1] && mazeWalls[cellX][cellZ][2] && mazeWalls[cellX][cellZ][3])
+		if (maze.isClosed(cell.x, cell.y))
 		{
-			for (int xx = 0; xx < 14; xx++)
-			{
-				for (int zz = 0; zz < 14; zz++)
-				{
-					setWallVoxel(chunkStart.x + 1 + xx, 0, chunkStart.z + 1 + zz);
-				}
-			}
+			addPiece(DungeonPiece::CORE, 0);
 
 			// also add a tree in the center
-			setTree(chunkStart.x + Randomizer::getRandomInt(3, 10), 0, chunkStart.z + Randomizer::getRandomInt(3, 10));
+			glm::ivec3 tree(chunkStart.x + Randomizer::getRandomInt(3, 10), 0, chunkStart.z + Randomizer::getRandomInt(3, 10));
+			StructurePlacement placement = { getTreeStamp(tree.x, tree.y, tree.z), tree };
+			pieces.push_back(placement);
 		}
+	}
+
+	void loadChunk(int x, int y, int z)
+	{
+		if (y != 0) { return; }
+
+		std::vector<StructurePlacement> pieces;
+		getChunkPieces(mMaze, mThemeId, glm::ivec2(x - (mPosition.x / 16), z - (mPosition.z / 16)), glm::ivec3(x, y, z), pieces);
+		for (auto& piece : pieces) { placeStructure(piece.mStamp, piece.mOrigin); }
 
 		// mark as a dungeon generated chunk
 		// TODO: ensure chunk is actually created before doing this
@@ -6228,19 +6559,169 @@ void registerBiomeAttributes(BiomeType type, int psx, int psy, int psz, int rl,
 	registeredBiomes[type].reset(attrib);
 }
 
-std::unordered_map<glm::ivec2, BiomeType, KeyHash_GLMIVec2, KeyEqual_GLMIVec2> loadedBiomes;
+void registerDefaultBiomes()
+{
+	registerBiomeAttributes(BiomeType::FOREST, 128, 128, 128, 0, 30, 100, 255, 0, 30, true);
+	registerBiomeAttributes(BiomeType::PLAIN, 1024, 32, 1024, 0, 30, 100, 255, 0, 30, true);
+	registerBiomeAttributes(BiomeType::ICE, 512, 64, 512, 0, 198, 239, 239, 255, 255, false);
+	registerBiomeAttributes(BiomeType::JUNGLE, 256, 256, 256, 0, 15, 0, 75, 0, 15, true);
+	registerBiomeAttributes(BiomeType::DESERT, 2048, 128, 2048, 232, 232, 232, 232, 155, 221, false);
+	registerBiomeAttributes(BiomeType::MOUNTAINS, 32, 2048, 32, 112, 183, 94, 153, 68, 111, false);
+}
+
+const int BIOME_TYPE_COUNT = (int)BiomeType::MOUNTAINS + 1;
+
+const BiomeAttributes* getBiomeAttributes(BiomeType type) { return registeredBiomes.find(type)->second.get(); }
 
-// retrieves (and creates as necessary) the biome for any given chunk
-BiomeType getChunkBiome(int x, int z)
+// biomes are voronoi cells around one seeded point per 256x256 column grid cell, so the biome of any column is found
+// from the 5x5 grid cells around it without storing anything. columns close to a border mix the biomes on both sides
+const int BIOME_CELL_SIZE = 256;
+const int BIOME_CELL_JITTER_MARGIN = 32; // keeps points apart so no biome is tiny
+const float BIOME_BLEND_WIDTH = 32.0f;
+// a column can be sqrt(2) * (256 - 32) ~ 317 from its own cell's point, and a point two cells away as close as
+// 256 + 32 = 288, so 3x3 cells would miss the closest point at some corners. every point three cells away is at least
+// 2 * 256 + 32 = 544 away, more than 317 + BIOME_BLEND_WIDTH
+const int BIOME_CELL_REACH = 2;
+const int BIOME_CELL_SPAN = BIOME_CELL_REACH * 2 + 1;
+const int BIOME_CELL_POINTS = BIOME_CELL_SPAN * BIOME_CELL_SPAN;
+
+// how much of each biome a column is made of, the weights add up to 1
+struct BiomeBlend
 {
-	glm::ivec2 pos(x / 16, z / 16);
+	float mWeights[BIOME_TYPE_COUNT];
+	BiomeType mDominant; // the biome of the closest point
 
-	auto it = loadedBiomes.find(pos);
-	if (it != loadedBiomes.end()) { return it->second; }
+	float getWeight(BiomeType type) const { return mWeights[(int)type]; }
+};
 
-	BiomeType ret = (BiomeType)Randomizer::getRandomInt((int)BiomeType::FOREST, (int)BiomeType::MOUNTAINS);
-	loadedBiomes[pos] = ret;
-	return ret;
+// the seeded point of a grid cell and its biome
+void getBiomeCellPoint(int cellX, int cellZ, glm::vec2& point, BiomeType& type)
+{
+	RandomStream stream(Randomizer::getStreamKey(RandomPurpose::BIOME, cellX, 0, cellZ));
+	point.x = (float)(cellX * BIOME_CELL_SIZE + stream.nextInt(BIOME_CELL_JITTER_MARGIN, BIOME_CELL_SIZE - BIOME_CELL_JITTER_MARGIN));
+	point.y = (float)(cellZ * BIOME_CELL_SIZE + stream.nextInt(BIOME_CELL_JITTER_MARGIN, BIOME_CELL_SIZE - BIOME_CELL_JITTER_MARGIN));
+	type = (BiomeType)stream.nextInt((int)BiomeType::FOREST, (int)BiomeType::MOUNTAINS);
+}
+
+// the seeded points and biomes of a grid cell and its neighbours, the same for every column in the cell
+struct BiomeCellNeighbourhood
+{
+	glm::vec2 mPoints[BIOME_CELL_POINTS];
+	BiomeType mTypes[BIOME_CELL_POINTS];
+
+	BiomeCellNeighbourhood(int cellX, int cellZ)
+	{
+		for (int i = 0; i < BIOME_CELL_POINTS; i++) { getBiomeCellPoint(cellX + i % BIOME_CELL_SPAN - BIOME_CELL_REACH, cellZ + i / BIOME_CELL_SPAN - BIOME_CELL_REACH, mPoints[i], mTypes[i]); }
+	}
+};
+
+// blends every point less than BIOME_BLEND_WIDTH further away than the closest one, weighted by how much further away it
+// is. at a border both sides weigh the same, so attributes change continuously across it. the neighbourhood has to be
+// the one of the column's cell
+BiomeBlend getColumnBiomes(int x, int z, const BiomeCellNeighbourhood& cells)
+{
+	glm::vec2 column((float)x, (float)z);
+
+	float distances[BIOME_CELL_POINTS];
+	int closest = 0;
+	for (int i = 0; i < BIOME_CELL_POINTS; i++)
+	{
+		distances[i] = glm::distance(column, cells.mPoints[i]);
+		if (distances[i] < distances[closest]) { closest = i; }
+	}
+
+	BiomeBlend blend;
+	std::fill(blend.mWeights, blend.mWeights + BIOME_TYPE_COUNT, 0.0f);
+	blend.mDominant = cells.mTypes[closest];
+	float total = 0.0f;
+	for (int i = 0; i < BIOME_CELL_POINTS; i++)
+	{
+		float weight = 1.0f - (distances[i] - distances[closest]) / BIOME_BLEND_WIDTH;
+		if (weight <= 0.0f) { continue; }
+		blend.mWeights[(int)cells.mTypes[i]] += weight;
+		total += weight;
+	}
+	for (float& weight : blend.mWeights) { weight /= total; }
+	return blend;
+}
+
+BiomeBlend getColumnBiomes(int x, int z) { return getColumnBiomes(x, z, BiomeCellNeighbourhood(floorDiv(x, BIOME_CELL_SIZE), floorDiv(z, BIOME_CELL_SIZE))); }
+
+// -biometest, compares getColumnBiomes with going through every cell point far around the column, for every column of a
+// few cells. returns how many columns differ
+int runBiomeTest()
+{
+	const int bruteReach = 4;
+	int columns = 0;
+	int failures = 0;
+	for (int cellX = -2; cellX < 2; cellX++)
+	{
+		for (int cellZ = -2; cellZ < 2; cellZ++)
+		{
+			BiomeCellNeighbourhood cells(cellX, cellZ);
+			std::vector<glm::vec2> points;
+			std::vector<BiomeType> types;
+			for (int x = cellX - bruteReach; x <= cellX + bruteReach; x++)
+			{
+				for (int z = cellZ - bruteReach; z <= cellZ + bruteReach; z++)
+				{
+					glm::vec2 point;
+					BiomeType type;
+					getBiomeCellPoint(x, z, point, type);
+					points.push_back(point);
+					types.push_back(type);
+				}
+			}
+
+			for (int x = cellX * BIOME_CELL_SIZE; x < (cellX + 1) * BIOME_CELL_SIZE; x++)
+			{
+				for (int z = cellZ * BIOME_CELL_SIZE; z < (cellZ + 1) * BIOME_CELL_SIZE; z++)
+				{
+					glm::vec2 column((float)x, (float)z);
+					size_t closest = 0;
+					for (size_t i = 0; i < points.size(); i++) { if (glm::distance(column, points[i]) < glm::distance(column, points[closest])) { closest = i; } }
+
+					float weights[BIOME_TYPE_COUNT] = {};
+					float total = 0.0f;
+					for (size_t i = 0; i < points.size(); i++)
+					{
+						float weight = 1.0f - (glm::distance(column, points[i]) - glm::distance(column, points[closest])) / BIOME_BLEND_WIDTH;
+						if (weight <= 0.0f) { continue; }
+						weights[(int)types[i]] += weight;
+						total += weight;
+					}
+
+					BiomeBlend blend = getColumnBiomes(x, z, cells);
+					bool same = blend.mDominant == types[closest];
+					for (int type = 0; type < BIOME_TYPE_COUNT; type++) { same &= std::abs(blend.mWeights[type] - weights[type] / total) < 1.0e-4f; }
+					if (!same)
+					{
+						if (failures < 10) { printf("column [%d, %d] differs from the brute force search\n", x, z); }
+						failures++;
+					}
+					columns++;
+				}
+			}
+		}
+	}
+	printf("biome test: %d of %d columns differ\n", failures, columns);
+	return failures;
+}
+
+// voxel color ranges mixed by the biome weights
+void getBlendedColorRange(const BiomeBlend& blend, glm::ivec3& low, glm::ivec3& high)
+{
+	glm::vec3 mixedLow(0.0f), mixedHigh(0.0f);
+	for (int type = 0; type < BIOME_TYPE_COUNT; type++)
+	{
+		float weight = blend.mWeights[type];
+		if (weight == 0.0f) { continue; }
+		const BiomeAttributes* biome = getBiomeAttributes((BiomeType)type);
+		mixedLow += weight * glm::vec3((float)biome->redLow, (float)biome->greenLow, (float)biome->blueLow);
+		mixedHigh += weight * glm::vec3((float)biome->redHigh, (float)biome->greenHigh, (float)biome->blueHigh);
+	}
+	low = glm::ivec3((int)std::round(mixedLow.x), (int)std::round(mixedLow.y), (int)std::round(mixedLow.z));
+	high = glm::ivec3((int)std::round(mixedHigh.x), (int)std::round(mixedHigh.y), (int)std::round(mixedHigh.z));
 }
 
 #pragma endregion
@@ -6348,18 +6829,18 @@ bool VoxelEditCheckCallback(VolumeSampler& s)
 		voxelEditSolidFound = true;
 
 		// debug air
-		glColor3f(0.25f, 0.25f, 1.0f);
-		glPushMatrix();
-		glTranslatef((float)voxelEditAir.x + 0.5f, (float)voxelEditAir.y + 0.5f, (float)voxelEditAir.z + 0.5f);
-		glutWireCube(1.00001);
-		glPopMatrix();
+		Renderer::color3f(0.25f, 0.25f, 1.0f);
+		Renderer::pushMatrix();
+		Renderer::translatef((float)voxelEditAir.x + 0.5f, (float)voxelEditAir.y + 0.5f, (float)voxelEditAir.z + 0.5f);
+		Renderer::wireCube(1.00001);
+		Renderer::popMatrix();
 
 		// debug solid
-		glColor3f(1.0f, 0.25f, 0.25f);
-		glPushMatrix();
-		glTranslatef((float)voxelEditSolid.x + 0.5f, (float)voxelEditSolid.y + 0.5f, (float)voxelEditSolid.z + 0.5f);
-		glutWireCube(1.00001);
-		glPopMatrix();
+		Renderer::color3f(1.0f, 0.25f, 0.25f);
+		Renderer::pushMatrix();
+		Renderer::translatef((float)voxelEditSolid.x + 0.5f, (float)voxelEditSolid.y + 0.5f, (float)voxelEditSolid.z + 0.5f);
+		Renderer::wireCube(1.00001);
+		Renderer::popMatrix();
 	}
 
 	return !voxelEditSolidFound;
@@ -6397,6 +6878,10 @@ void voxelEditorModify(bool place)
 
 	// apply modification if everything is good
 	setVoxel(usedPos.x, usedPos.y, usedPos.z, usedType.r, usedType.g, usedType.b, usedType.a);
+	glm::ivec3 chunkPos(getVoxelChunkPos(usedPos));
+	VolumeChunk* chunk = mChunks[chunkPos].get();
+	chunk->mPlayerEdited = true;
+	ChunkEventBus::publish(ChunkEvent::EDITED, chunkPos, chunk);
 }
 
 #pragma endregion
@@ -6411,6 +6896,14 @@ private:
 public:
 	int getInt(const std::string& cat, const std::string& name) { return std::stoi(data[cat][name]); }
 	float getFloat(const std::string& cat, const std::string& name) { return std::stof(data[cat][name]); }
+	int getInt(const std::string& cat, const std::string& name, int def) { return has(cat, name) ? getInt(cat, name) : def; }
+	float getFloat(const std::string& cat, const std::string& name, float def) { return has(cat, name) ? getFloat(cat, name) : def; }
+
+	bool has(const std::string& cat, const std::string& name)
+	{
+		auto it = data.find(cat);
+		return it != data.end() && it->second.count(name) != 0;
+	}
 
 	void setInt(const std::string& cat, const std::string& name, int val) { data[cat][name] = std::to_string(val); }
 	void setFloat(const std::string& cat, const std::string& name, float val) { data[cat][name] = std::to_string(val); }
@@ -6518,6 +7011,12 @@ void loadConfig()
 
 	// statistics
 	playerDeaths = cfg.getInt("Statistics", "deaths");
+
+	// graphics, added later so older files may not have them
+	volumeRenderDistanceMin = std::max(1, cfg.getInt("Graphics", "minRenderDistance", volumeRenderDistanceMin));
+	volumeRenderDistanceMax = std::max(volumeRenderDistanceMin, cfg.getInt("Graphics", "maxRenderDistance", volumeRenderDistanceMax));
+	FrameScheduler::setTargetFrameMillis(1000.0f / cfg.getFloat("Graphics", "targetFps", 1000.0f / FrameScheduler::getTargetFrameMillis()));
+	volumeRenderDistance = std::max(volumeRenderDistanceMin, std::min(volumeRenderDistance, volumeRenderDistanceMax));
 }
 
 void saveConfig()
@@ -6553,6 +7052,11 @@ void saveConfig()
 		cfg.setInt("PlayerSkills", "skill" + std::to_string(i) + "Exp", skill->getExp());
 	}
 
+	// graphics
+	cfg.setInt("Graphics", "minRenderDistance", volumeRenderDistanceMin);
+	cfg.setInt("Graphics", "maxRenderDistance", volumeRenderDistanceMax);
+	cfg.setFloat("Graphics", "targetFps", 1000.0f / FrameScheduler::getTargetFrameMillis());
+
 	// statistics
 	cfg.setInt("Statistics", "deaths", playerDeaths);
 	cfg.setFloat("Statistics", "totalTravelDistance", playerTotalTravelDistance);
@@ -6585,17 +7089,17 @@ public:
 	{
 		float flareFactor = glm::mix(0.0f, 3.141592f, (float)((Tools::currentTimeMillis() - mDropTime) % 4500) / 4500.0f);
 
-		glColor3f(0.5f, 0.5f, 0.5f);
-		glPushMatrix();
-		glTranslatef(mPosition.x, mPosition.y + 0.25f + (sinf(flareFactor) / 2.0f), mPosition.z); // move to correct location
-		glTranslatef(0.0f, 0.5f, 0.0f); // raise above ground offset
-		glScalef(0.021f, 0.021f, 0.021f); // resizing
-		glRotatef(180.0f, 1.0f, 0.0f, 0.0f); // vertical flip
-		glRotatef(flareFactor * 2.0f * 57.2958f, 0.0f, 1.0f, 0.0f); // flare rotate
-		glTranslatef(-24.0f, 0.0f, 0.0f); // center for rotation
+		Renderer::color3f(0.5f, 0.5f, 0.5f);
+		Renderer::pushMatrix();
+		Renderer::translatef(mPosition.x, mPosition.y + 0.25f + (sinf(flareFactor) / 2.0f), mPosition.z); // move to correct location
+		Renderer::translatef(0.0f, 0.5f, 0.0f); // raise above ground offset
+		Renderer::scalef(0.021f, 0.021f, 0.021f); // resizing
+		Renderer::rotatef(180.0f, 1.0f, 0.0f, 0.0f); // vertical flip
+		Renderer::rotatef(flareFactor * 2.0f * 57.2958f, 0.0f, 1.0f, 0.0f); // flare rotate
+		Renderer::translatef(-24.0f, 0.0f, 0.0f); // center for rotation
 		//glutSolidCube(0.25f);
 		ItemInformationProvider::getItemInfo(mItem->getItemId())->drawIcon();
-		glPopMatrix();
+		Renderer::popMatrix();
 	}
 };
 
@@ -6734,90 +7238,934 @@ public:
 
 std::unique_ptr<ICombatEntityListener> wavePlayerListener;
 
-void updateWaveTransition()
-{
-	if (waveTransition && getWaveRemainingTransitionTime() <= 0)
+void updateWaveTransition()
+{
+	if (waveTransition && getWaveRemainingTransitionTime() <= 0)
+	{
+		currentWave++;
+		waveEnemiesKilled = 0;
+		waveTransition = false;
+		NpcManager::unloadNpc(1);
+		UIWindowManager::getWindowByTitle("Shop")->setVisible(false);
+	}
+}
+
+#pragma endregion
+
+#pragma region Map Loading
+
+std::vector<std::unique_ptr<Dungeon>> dungeons;
+FeatureGrid<Dungeon> dungeonGrid(FEATURE_GRID_CELL_CHUNKS); // by the chunk columns they cover
+Dungeon* activeDungeon = 0;
+
+// towns are found through their dungeon, which covers the whole town
+void addDungeon(Dungeon* dungeon)
+{
+	dungeons.push_back(std::unique_ptr<Dungeon>(dungeon));
+	glm::ivec2 lower, upper;
+	dungeon->getChunkFootprint(lower, upper);
+	dungeonGrid.insert(dungeon, lower, upper);
+}
+
+Dungeon* getChunkDungeon(int x, int y, int z)
+{
+	for (Dungeon* dungeon : dungeonGrid.getCandidates(glm::ivec2(x, z)))
+	{
+		if (dungeon->usesChunk(x, y, z)) { return dungeon; }
+	}
+	return 0;
+}
+
+// if any dungeon starts closer than distance voxels to pos
+bool isDungeonNear(const glm::vec3& pos, float distance)
+{
+	// a dungeon's footprint starts at its position, so its cells are within reach of pos if the position is
+	glm::ivec2 chunk(floorDiv((int)std::floorf(pos.x), 16), floorDiv((int)std::floorf(pos.z), 16));
+	int reach = (int)std::ceilf(distance / 16.0f);
+	return dungeonGrid.findInArea(chunk - reach, chunk + reach, [&pos, distance](Dungeon* dungeon)
+	{
+		// distance complains without floating point vectors............
+		return glm::distance(pos, glm::vec3(dungeon->getPosition())) < distance;
+	});
+}
+
+// the terrain is a 2d height per column, from a few octaves of noise at each biome's horizontal scale, plus 3d noise at
+// the biome's scales for overhangs. the 3d noise moves the surface by at most TERRAIN_DETAIL_BOUND, so it only has to
+// be evaluated in a thin band around the height. a moisture layer decides where trees grow
+const double TERRAIN_BASE_HEIGHT = 18.0;
+const double TERRAIN_RELIEF = 13.0;
+const double TERRAIN_DETAIL = 4.0;
+const int TERRAIN_HEIGHT_OCTAVES = 4;
+const double TERRAIN_HEIGHT_PLANE = 100.37;
+const double TERRAIN_MOISTURE_SCALE = 512.0;
+const int TERRAIN_MOISTURE_OCTAVES = 3;
+const double TERRAIN_MOISTURE_PLANE = 200.81;
+const float TREE_MIN_MOISTURE = -0.25f;
+
+// improved noise stays within about +-1.036
+const double NOISE_MAGNITUDE_BOUND = 1.04;
+const double TERRAIN_DETAIL_BOUND = TERRAIN_DETAIL * NOISE_MAGNITUDE_BOUND;
+const double TERRAIN_LOWEST = TERRAIN_BASE_HEIGHT - TERRAIN_RELIEF * NOISE_MAGNITUDE_BOUND - TERRAIN_DETAIL_BOUND; // about 0.3
+const double TERRAIN_HIGHEST = TERRAIN_BASE_HEIGHT + TERRAIN_RELIEF * NOISE_MAGNITUDE_BOUND + TERRAIN_DETAIL_BOUND; // about 35.7
+
+// octaves of noise on a plane through the 3d noise, each one twice the frequency and half the amplitude of the last.
+// normalized to the range of a single octave
+double fbm2(double x, double z, double plane, int octaves)
+{
+	double sum = 0.0, amplitude = 1.0, total = 0.0;
+	for (int i = 0; i < octaves; i++)
+	{
+		sum += amplitude * noise.noise(x, plane + i * 17.0, z);
+		total += amplitude;
+		x *= 2.0;
+		z *= 2.0;
+		amplitude *= 0.5;
+	}
+	return sum / total;
+}
+
+// the 2d layers of a chunk column, shared by all chunks stacked in it
+struct TerrainColumn
+{
+	glm::ivec2 mPosition; // chunk x, z
+	float mHeights[16][16]; // surface before the 3d detail
+	float mMoisture[16][16];
+	float mBiomeWeights[16][16][BIOME_TYPE_COUNT];
+	BiomeType mDominantBiomes[16][16];
+	glm::ivec3 mColorLow[16][16];
+	glm::ivec3 mColorHigh[16][16];
+	bool mPresentBiomes[BIOME_TYPE_COUNT];
+	float mLowest; // of the heights
+	float mHighest;
+
+	float getHeight(int x, int z) const { return mHeights[x - mPosition.x * 16][z - mPosition.y * 16]; }
+};
+
+std::shared_ptr<const TerrainColumn> computeTerrainColumn(int x, int z)
+{
+	std::shared_ptr<TerrainColumn> column = std::make_shared<TerrainColumn>();
+	column->mPosition = glm::ivec2(x, z);
+	std::fill(column->mPresentBiomes, column->mPresentBiomes + BIOME_TYPE_COUNT, false);
+	column->mLowest = std::numeric_limits<float>::max();
+	column->mHighest = std::numeric_limits<float>::lowest();
+
+	BiomeCellNeighbourhood cells(floorDiv(x * 16, BIOME_CELL_SIZE), floorDiv(z * 16, BIOME_CELL_SIZE)); // chunks never straddle cells
+	for (int xx = 0; xx < 16; xx++)
+	{
+		for (int zz = 0; zz < 16; zz++)
+		{
+			int worldX = x * 16 + xx;
+			int worldZ = z * 16 + zz;
+			BiomeBlend blend = getColumnBiomes(worldX, worldZ, cells);
+
+			double height = 0.0;
+			for (int type = 0; type < BIOME_TYPE_COUNT; type++)
+			{
+				float weight = blend.mWeights[type];
+				column->mBiomeWeights[xx][zz][type] = weight;
+				if (weight == 0.0f) { continue; }
+
+				const BiomeAttributes* biome = getBiomeAttributes((BiomeType)type);
+				height += weight * (TERRAIN_BASE_HEIGHT + TERRAIN_RELIEF * fbm2(worldX / biome->perlinScaleX, worldZ / biome->perlinScaleZ, TERRAIN_HEIGHT_PLANE, TERRAIN_HEIGHT_OCTAVES));
+				column->mPresentBiomes[type] = true;
+			}
+
+			column->mHeights[xx][zz] = (float)height;
+			column->mLowest = std::min(column->mLowest, (float)height);
+			column->mHighest = std::max(column->mHighest, (float)height);
+			column->mMoisture[xx][zz] = (float)fbm2(worldX / TERRAIN_MOISTURE_SCALE, worldZ / TERRAIN_MOISTURE_SCALE, TERRAIN_MOISTURE_PLANE, TERRAIN_MOISTURE_OCTAVES);
+			column->mDominantBiomes[xx][zz] = blend.mDominant;
+			getBlendedColorRange(blend, column->mColorLow[xx][zz], column->mColorHigh[xx][zz]);
+		}
+	}
+	return column;
+}
+
+// recently used columns, generation workers and the minimap preview threads share them
+struct TerrainColumnEntry
+{
+	std::shared_ptr<const TerrainColumn> mColumn;
+	unsigned int mLastUsed = 0;
+};
+
+const size_t TERRAIN_COLUMN_CACHE_SIZE = 1024;
+std::unordered_map<glm::ivec2, TerrainColumnEntry, KeyHash_GLMIVec2, KeyEqual_GLMIVec2> terrainColumns;
+unsigned int terrainColumnUseCount = 0;
+std::mutex terrainColumnsMutex;
+
+std::shared_ptr<const TerrainColumn> getTerrainColumn(int x, int z)
+{
+	glm::ivec2 pos(x, z);
+	{
+		std::lock_guard<std::mutex> lock(terrainColumnsMutex);
+		auto it = terrainColumns.find(pos);
+		if (it != terrainColumns.end())
+		{
+			it->second.mLastUsed = ++terrainColumnUseCount;
+			return it->second.mColumn;
+		}
+	}
+
+	// computed outside of the lock, two threads computing the same column get the same result
+	std::shared_ptr<const TerrainColumn> column = computeTerrainColumn(x, z);
+
+	std::lock_guard<std::mutex> lock(terrainColumnsMutex);
+	TerrainColumnEntry& entry = terrainColumns[pos];
+	entry.mColumn = column;
+	entry.mLastUsed = ++terrainColumnUseCount;
+
+	// drop the least recently used half once full
+	if (terrainColumns.size() > TERRAIN_COLUMN_CACHE_SIZE)
+	{
+		std::vector<unsigned int> lastUsed;
+		lastUsed.reserve(terrainColumns.size());
+		for (auto& it : terrainColumns) { lastUsed.push_back(it.second.mLastUsed); }
+		std::nth_element(lastUsed.begin(), lastUsed.begin() + lastUsed.size() / 2, lastUsed.end());
+		unsigned int oldest = lastUsed[lastUsed.size() / 2];
+		for (auto it = terrainColumns.begin(); it != terrainColumns.end();)
+		{
+			if (it->second.mLastUsed < oldest) { it = terrainColumns.erase(it); }
+			else { ++it; }
+		}
+	}
+	return column;
+}
+
+void clearTerrainColumns()
+{
+	std::lock_guard<std::mutex> lock(terrainColumnsMutex);
+	terrainColumns.clear();
+}
+
+// the 3d detail at a voxel, every biome's noise at its own scales mixed by the biome weights
+double getTerrainDetail(const TerrainColumn& column, int x, int y, int z)
+{
+	const float* weights = column.mBiomeWeights[x - column.mPosition.x * 16][z - column.mPosition.y * 16];
+	double detail = 0.0;
+	for (int type = 0; type < BIOME_TYPE_COUNT; type++)
+	{
+		if (weights[type] == 0.0f) { continue; }
+		const BiomeAttributes* biome = getBiomeAttributes((BiomeType)type);
+		detail += weights[type] * noise.noise((double)x / biome->perlinScaleX, (double)y / biome->perlinScaleY, (double)z / biome->perlinScaleZ);
+	}
+	return detail;
+}
+
+bool isTerrainSolid(const TerrainColumn& column, int x, int y, int z)
+{
+	double height = column.getHeight(x, z);
+	if (y > height + TERRAIN_DETAIL_BOUND) { return false; }
+	if (y <= height - TERRAIN_DETAIL_BOUND) { return true; }
+	return y <= (int)std::floor(height + TERRAIN_DETAIL * getTerrainDetail(column, x, y, z));
+}
+
+// how much of a chunk the terrain fills
+enum class NoiseChunkFill
+{
+	EMPTY,
+	SOLID,
+	MIXED
+};
+
+bool noiseChunkClassification = true; // only turned off by -noisebench to compare
+std::atomic<int> noiseChunkFillCounts[3];
+
+// the chunks the terrain bounds alone decide
+NoiseChunkFill classifyNoiseChunkLayer(int y)
+{
+	if (TERRAIN_HIGHEST < y * 16) { return NoiseChunkFill::EMPTY; }
+	if (TERRAIN_LOWEST >= y * 16 + 15) { return NoiseChunkFill::SOLID; }
+	return NoiseChunkFill::MIXED;
+}
+
+// decides if a chunk is entirely air or entirely terrain from its column's heights, so generateNoiseVolume can skip
+// the per voxel noise
+NoiseChunkFill classifyNoiseChunk(const TerrainColumn& column, int y)
+{
+	NoiseChunkFill fill = classifyNoiseChunkLayer(y);
+	if (fill != NoiseChunkFill::MIXED) { return fill; }
+
+	if (column.mHighest + TERRAIN_DETAIL_BOUND < y * 16) { return NoiseChunkFill::EMPTY; }
+	if (column.mLowest - TERRAIN_DETAIL_BOUND >= y * 16 + 15) { return NoiseChunkFill::SOLID; }
+	return NoiseChunkFill::MIXED;
+}
+
+thread_local std::vector<float> biomeNoiseBatches;
+
+// fills a chunk's volume with perlin terrain. only touches the given volume, so it is safe on the pipeline workers
+void generateNoiseVolume(VoxelVolume* volume, int x, int y, int z)
+{
+	if (noiseChunkClassification && classifyNoiseChunkLayer(y) == NoiseChunkFill::EMPTY)
+	{
+		noiseChunkFillCounts[(int)NoiseChunkFill::EMPTY]++;
+		return;
+	}
+
+	std::shared_ptr<const TerrainColumn> column = getTerrainColumn(x, z);
+	int xxStart = x * 16;
+	int yyStart = y * 16;
+	int zzStart = z * 16;
+
+	auto setTerrainVoxel = [&](int xx, int yy, int zz)
+	{
+		const glm::ivec3& low = column->mColorLow[xx - xxStart][zz - zzStart];
+		const glm::ivec3& high = column->mColorHigh[xx - xxStart][zz - zzStart];
+		volume->setVoxelAt(xx, yy, zz, VoxelType(Randomizer::getRandomInt(low.r, high.r), Randomizer::getRandomInt(low.g, high.g), Randomizer::getRandomInt(low.b, high.b), 255));
+	};
+
+	Randomizer::SeededScope seeded(RandomPurpose::TERRAIN, x, y, z);
+	NoiseChunkFill fill = noiseChunkClassification ? classifyNoiseChunk(*column, y) : NoiseChunkFill::MIXED;
+	noiseChunkFillCounts[(int)fill]++;
+	if (fill == NoiseChunkFill::EMPTY) { return; }
+	if (fill == NoiseChunkFill::SOLID)
+	{
+		for (int xx = xxStart; xx < xxStart + 16; xx++)
+		{
+			for (int yy = yyStart; yy < yyStart + 16; yy++)
+			{
+				for (int zz = zzStart; zz < zzStart + 16; zz++) { setTerrainVoxel(xx, yy, zz); }
+			}
+		}
+		return;
+	}
+
+	// the 3d detail is only needed in the band around the surface, batched per biome over the layers it covers
+	int bandLow = yyStart;
+	int bandHigh = yyStart + 15;
+	if (noiseChunkClassification)
+	{
+		bandLow = std::max(bandLow, (int)std::floor(column->mLowest - TERRAIN_DETAIL_BOUND));
+		bandHigh = std::min(bandHigh, (int)std::ceil(column->mHighest + TERRAIN_DETAIL_BOUND));
+	}
+	int bandSize = bandHigh - bandLow + 1;
+
+	std::vector<float>& batches = biomeNoiseBatches;
+	batches.resize(BIOME_TYPE_COUNT * 4096);
+	for (int type = 0; type < BIOME_TYPE_COUNT; type++)
+	{
+		if (!column->mPresentBiomes[type]) { continue; }
+		const BiomeAttributes* biome = getBiomeAttributes((BiomeType)type);
+
+		double xs[16], ys[16], zs[16];
+		for (int i = 0; i < 16; i++)
+		{
+			xs[i] = (double)(xxStart + i) / biome->perlinScaleX;
+			ys[i] = (double)(bandLow + i) / biome->perlinScaleY;
+			zs[i] = (double)(zzStart + i) / biome->perlinScaleZ;
+		}
+		noise.noiseGrid(xs, 16, ys, bandSize, zs, 16, &batches[type * 4096]);
+	}
+
+	for (int xx = xxStart; xx < xxStart + 16; xx++)
+	{
+		for (int yy = yyStart; yy < yyStart + 16; yy++)
+		{
+			for (int zz = zzStart; zz < zzStart + 16; zz++)
+			{
+				double height = column->mHeights[xx - xxStart][zz - zzStart];
+				bool solid;
+				if (noiseChunkClassification && yy > height + TERRAIN_DETAIL_BOUND) { solid = false; }
+				else if (noiseChunkClassification && yy <= height - TERRAIN_DETAIL_BOUND) { solid = true; }
+				else
+				{
+					const float* weights = column->mBiomeWeights[xx - xxStart][zz - zzStart];
+					int index = ((xx - xxStart) * bandSize + yy - bandLow) * 16 + zz - zzStart;
+					double detail = 0.0;
+					for (int type = 0; type < BIOME_TYPE_COUNT; type++) { if (weights[type] != 0.0f) { detail += weights[type] * batches[type * 4096 + index]; } }
+					double density = height + TERRAIN_DETAIL * detail;
+					// the float result could round to the other side of a whole number, those few points use the exact noise
+					// so the terrain is the same as isTerrainSolid
+					if (std::abs(density - std::round(density)) <= PerlinNoise::BATCH_EPSILON * TERRAIN_DETAIL) { density = height + TERRAIN_DETAIL * getTerrainDetail(*column, xx, yy, zz); }
+					solid = yy <= (int)std::floor(density);
+				}
+				if (solid) { setTerrainVoxel(xx, yy, zz); }
+			}
+		}
+	}
+}
+
+// -noisebench, samples per second of noise() against every batch kernel the cpu supports on chunk sized grids, then
+// chunks per second of terrain generation with and without classifyNoiseChunk
+void runNoiseBenchmark()
+{
+	const int chunks = 2000;
+	auto secondsSince = [](std::chrono::steady_clock::time_point start) { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+	double xs[16], ys[16], zs[16];
+	auto setChunk = [&](int chunk)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			xs[i] = (double)((chunk % 50) * 16 + i) / 30.0;
+			ys[i] = (double)((chunk / 50 % 4) * 16 + i) / 30.0;
+			zs[i] = (double)((chunk / 200) * 16 + i) / 30.0;
+		}
+	};
+
+	std::vector<float> reference((size_t)chunks * 4096);
+	double checksum = 0.0;
+	auto start = std::chrono::steady_clock::now();
+	for (int c = 0; c < chunks; c++)
+	{
+		setChunk(c);
+		for (int i = 0; i < 4096; i++)
+		{
+			double n = noise.noise(xs[i / 256], ys[i / 16 % 16], zs[i % 16]);
+			reference[(size_t)c * 4096 + i] = (float)n;
+			checksum += n;
+		}
+	}
+	double seconds = secondsSince(start);
+	printf("noise() %.1f million samples/s (checksum %f)\n", chunks * 4096 / seconds / 1.0e6, checksum);
+
+	float batch[4096];
+	for (NoiseKernel kernel : { NoiseKernel::SCALAR, NoiseKernel::SSE4, NoiseKernel::AVX2 })
+	{
+		if (!PerlinNoise::isKernelSupported(kernel)) { printf("%s not supported\n", PerlinNoise::getKernelName(kernel)); continue; }
+
+		double maxError = 0.0;
+		start = std::chrono::steady_clock::now();
+		for (int c = 0; c < chunks; c++)
+		{
+			setChunk(c);
+			noise.noiseGrid(xs, 16, ys, 16, zs, 16, batch, kernel);
+			for (int i = 0; i < 4096; i++) { maxError = std::max(maxError, (double)std::abs(batch[i] - reference[(size_t)c * 4096 + i])); }
+		}
+		seconds = secondsSince(start);
+		printf("%s %.1f million samples/s, max error %g\n", PerlinNoise::getKernelName(kernel), chunks * 4096 / seconds / 1.0e6, maxError);
+	}
+
+	// whole chunks the way the pipeline generates them, the five layers the player is usually around
+	registerDefaultBiomes();
+	for (bool classification : { false, true })
+	{
+		noiseChunkClassification = classification;
+		for (auto& count : noiseChunkFillCounts) { count = 0; }
+		clearTerrainColumns();
+
+		int generated = 0;
+		start = std::chrono::steady_clock::now();
+		for (int x = 0; x < 20; x++)
+		{
+			for (int y = -1; y <= 3; y++)
+			{
+				for (int z = 0; z < 20; z++)
+				{
+					VoxelVolume volume(x * 16, y * 16, z * 16, x * 16 + 16, y * 16 + 16, z * 16 + 16);
+					generateNoiseVolume(&volume, x, y, z);
+					generated++;
+				}
+			}
+		}
+		seconds = secondsSince(start);
+		printf("chunks %s classification and surface band: %.0f chunks/s (%d empty, %d solid, %d sampled)\n", classification ? "with" : "without", generated / seconds,
+			noiseChunkFillCounts[(int)NoiseChunkFill::EMPTY].load(), noiseChunkFillCounts[(int)NoiseChunkFill::SOLID].load(), noiseChunkFillCounts[(int)NoiseChunkFill::MIXED].load());
+	}
+	noiseChunkClassification = true;
+}
+
+// chunks generated ahead of the player's path, see updateChunkPrefetch
+std::unordered_set<glm::ivec3, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> chunkPrefetchPending; // in the pipeline
+std::unordered_set<glm::ivec3, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> chunkPrefetched; // installed, not reached yet
+
+// pre-generated chunks, see -pregen. the pipeline reads chunks from it instead of generating them
+std::unique_ptr<ChunkStore> chunkStore;
+
+// copies a chunk's volume in the chunk store's layout
+void packChunkVoxels(const VoxelVolume* volume, unsigned char* voxels)
+{
+	const glm::ivec3& lower = volume->getEnclosingRegion().getLowerCorner();
+	for (int z = 0; z < ChunkStore::CHUNK_EDGE; z++)
+	{
+		for (int y = 0; y < ChunkStore::CHUNK_EDGE; y++)
+		{
+			for (int x = 0; x < ChunkStore::CHUNK_EDGE; x++)
+			{
+				const VoxelType& type = volume->getVoxelAt(lower.x + x, lower.y + y, lower.z + z);
+				unsigned char* voxel = voxels + (x + (y + z * ChunkStore::CHUNK_EDGE) * ChunkStore::CHUNK_EDGE) * 4;
+				voxel[0] = type.r;
+				voxel[1] = type.g;
+				voxel[2] = type.b;
+				voxel[3] = type.a;
+			}
+		}
+	}
+}
+
+void unpackChunkVoxels(const unsigned char* voxels, VoxelVolume* volume)
+{
+	const glm::ivec3& lower = volume->getEnclosingRegion().getLowerCorner();
+	for (int z = 0; z < ChunkStore::CHUNK_EDGE; z++)
+	{
+		for (int y = 0; y < ChunkStore::CHUNK_EDGE; y++)
+		{
+			volume->setVoxelRun(lower.x, lower.y + y, lower.z + z, (const StampVoxel*)(voxels + (y + z * ChunkStore::CHUNK_EDGE) * ChunkStore::CHUNK_EDGE * 4), ChunkStore::CHUNK_EDGE);
+		}
+	}
+}
+
+// a chunk going through the pipeline. generation and decoration fill a private volume, which the main thread installs
+// once decorated
+struct VolumeChunkWork : public ChunkWork
+{
+	Dungeon* mDungeon = 0; // dungeon chunks are built by their dungeon on the main thread instead
+	std::unique_ptr<VoxelVolume> mVolume;
+	bool mTrees = false;
+	bool mStored = false; // read from the chunk store, already holding its structures
+	std::vector<glm::ivec3> mStructureChunks; // other chunks the chunk's tree reaches into
+	std::vector<StructurePlacement> mStructures; // copied into the volume so far
+	VolumeChunk* mChunk = 0; // set once installed, or from the start when only rebuilding the mesh
+	unsigned int mGeneration; // of the chunks the work was started for
+	bool mPlayerEdit = false; // rebuilding the mesh after the player edited the chunk
+	std::unique_ptr<Mesh> mMesh;
+	std::unique_ptr<PackedFaceMesh> mFaces;
+
+	VolumeChunkWork(const glm::ivec3& position, ChunkStage stage) : ChunkWork(position, stage), mGeneration(chunkWorldGeneration) {}
+};
+
+// finds the ground near the middle of the chunk and grows a tree on it. the part in the chunk itself goes to own
+void placeChunkTree(VolumeChunkWork* work, std::vector<StructurePlacement>& own)
+{
+	const glm::ivec3& pos = work->mPosition;
+	VoxelVolume* volume = work->mVolume.get();
+
+	// stored chunks already have trees in them, their ground is found in the terrain layers instead
+	std::shared_ptr<const TerrainColumn> column = getTerrainColumn(pos.x, pos.z);
+	auto isGround = [work, volume, &column](const glm::ivec3& voxel)
+	{
+		if (work->mStored) { return isTerrainSolid(*column, voxel.x, voxel.y, voxel.z); }
+		return !volume->getVoxelAt(voxel.x, voxel.y, voxel.z).isAir();
+	};
+
+	Randomizer::SeededScope seeded(RandomPurpose::TREE_PLACEMENT, pos.x, pos.y, pos.z);
+	glm::ivec3 treeStart(pos.x * 16 + Randomizer::getRandomInt(3, 7), pos.y * 16, pos.z * 16 + Randomizer::getRandomInt(3, 7));
+	// no tree spawns if ground doesn't exist on this chunk
+	if (!isGround(treeStart)) { return; }
+
+	treeStart.y++;
+	bool airFound = false;
+	for (int i = 0; i < 15; i++)
+	{
+		if (isGround(treeStart)) { treeStart.y++; }
+		else { airFound = true; break; }
+	}
+	if (!airFound) { return; }
+
+	StructurePlacement placement = { getTreeStamp(treeStart.x, treeStart.y, treeStart.z), treeStart };
+	std::vector<glm::ivec3> chunks;
+	StructurePlacementTable::getChunks(placement, chunks);
+	for (auto& chunk : chunks)
+	{
+		// stored chunks were written with the trees of their stored neighbours
+		if (chunk == pos) { if (!work->mStored) { own.push_back(placement); } }
+		else if (!work->mStored || !chunkStore->contains(chunk))
+		{
+			structurePlacements.add(chunk, placement);
+			work->mStructureChunks.push_back(chunk);
+		}
+	}
+}
+
+// places the chunk's tree and copies it and the structures waiting for the chunk into its own volume, in placement
+// order. the parts of the tree in other chunks are left in the placement table for them
+void decorateChunkVolume(VolumeChunkWork* work)
+{
+	const glm::ivec3& pos = work->mPosition;
+	VoxelVolume* volume = work->mVolume.get();
+
+	std::vector<StructurePlacement> placements;
+	if (work->mTrees) { placeChunkTree(work, placements); }
+	std::vector<StructurePlacement> waiting = structurePlacements.take(pos);
+	placements.insert(placements.end(), waiting.begin(), waiting.end());
+	std::sort(placements.begin(), placements.end());
+	for (auto& placement : placements) { copyStructureSlice(volume, pos, placement, work->mStructures); }
+}
+
+// runs the current stage of a chunk on a pipeline worker
+void chunkPipelineWorkerStage(ChunkWork* work)
+{
+	VolumeChunkWork* chunkWork = (VolumeChunkWork*)work;
+	const glm::ivec3& pos = work->mPosition;
+
+	if (work->mStage == ChunkStage::REQUESTED)
+	{
+		chunkWork->mVolume.reset(new VoxelVolume(pos.x * 16, pos.y * 16, pos.z * 16, pos.x * 16 + 16, pos.y * 16 + 16, pos.z * 16 + 16));
+		if (!chunkWork->mDungeon)
+		{
+			thread_local std::vector<unsigned char> storedVoxels(ChunkStore::CHUNK_BYTES);
+			chunkWork->mStored = chunkStore && chunkStore->read(pos, storedVoxels.data());
+			if (chunkWork->mStored) { unpackChunkVoxels(storedVoxels.data(), chunkWork->mVolume.get()); }
+			else { generateNoiseVolume(chunkWork->mVolume.get(), pos.x, pos.y, pos.z); }
+			// tree generation is determined by the biome attribute and needs enough moisture
+			std::shared_ptr<const TerrainColumn> column = getTerrainColumn(pos.x, pos.z);
+			chunkWork->mTrees = getBiomeAttributes(column->mDominantBiomes[8][8])->trees && column->mMoisture[8][8] >= TREE_MIN_MOISTURE;
+		}
+		work->mStage = ChunkStage::GENERATED;
+	}
+	else if (work->mStage == ChunkStage::GENERATED)
+	{
+		decorateChunkVolume(chunkWork);
+		work->mStage = ChunkStage::DECORATED;
+	}
+	else if (work->mStage == ChunkStage::DECORATED)
+	{
+		// the main thread keeps changing the chunk's own volume, the mesh is built from the copy taken with the work
+		if (VoxelFaceRenderer::isEnabled())
+		{
+			chunkWork->mFaces.reset(new PackedFaceMesh());
+			packVolumeSurface(chunkWork->mVolume.get(), chunkWork->mFaces.get());
+		}
+		else
+		{
+			chunkWork->mMesh.reset(new Mesh());
+			extractVolumeSurface(chunkWork->mVolume.get(), chunkWork->mMesh.get());
+		}
+		work->mStage = ChunkStage::MESHED;
+	}
+}
+
+// puts a decorated chunk into the world
+void installChunkWork(VolumeChunkWork* work)
+{
+	const glm::ivec3& pos = work->mPosition;
+
+	auto it = mChunks.find(pos);
+	bool keep = it != mChunks.end() && !it->second->mNeedsRegeneration;
+
+	// structures that reached the chunk since it was decorated, or were copied into it while it was in the world without
+	// its terrain, go in with its own in placement order. taken before the chunk is created, which would copy them into
+	// the empty chunk instead
+	std::vector<StructurePlacement> placements = structurePlacements.take(pos);
+	if (keep) { placements.insert(placements.end(), it->second->mStructures.begin(), it->second->mStructures.end()); }
+	for (auto& placement : placements) { copyStructureSlice(work->mVolume.get(), pos, placement, work->mStructures); }
+
+	VolumeChunk* chunk = it == mChunks.end() ? initChunk(pos.x, pos.y, pos.z) : it->second.get();
+
+	// keep whatever else was set in the chunk since it was requested, like the player's edits
+	if (keep)
+	{
+		const VolumeRegion& region = chunk->mVolume->getEnclosingRegion();
+		const glm::ivec3& lower = region.getLowerCorner();
+		glm::ivec3 size(region.getUpperCorner() - lower + 1);
+		std::vector<bool> structure((size_t)size.x * size.y * size.z, false);
+		for (auto& placement : chunk->mStructures)
+		{
+			placement.mStamp->forEachSpan(placement.mOrigin, lower, region.getUpperCorner(), [&](const glm::ivec3& start, const StampVoxel* voxels, int count)
+			{
+				for (int i = 0; i < count; i++) { structure[(start.x + i - lower.x) + ((start.y - lower.y) + (start.z - lower.z) * size.y) * size.x] = true; }
+			});
+		}
+
+		for (int x = region.getLowerCorner().x; x <= region.getUpperCorner().x; x++)
+		{
+			for (int y = region.getLowerCorner().y; y <= region.getUpperCorner().y; y++)
+			{
+				for (int z = region.getLowerCorner().z; z <= region.getUpperCorner().z; z++)
+				{
+					if (structure[(x - lower.x) + ((y - lower.y) + (z - lower.z) * size.y) * size.x]) { continue; }
+					const VoxelType& type = chunk->mVolume->getVoxelAt(x, y, z);
+					if (!type.isAir()) { work->mVolume->setVoxelAt(x, y, z, type); }
+				}
+			}
+		}
+	}
+
+	chunk->mVolume = std::move(work->mVolume);
+	chunk->mStructures = std::move(work->mStructures);
+	chunk->mNeedsRegeneration = false;
+	if (chunkPrefetchPending.erase(pos) != 0) { chunkPrefetched.insert(pos); }
+	ChunkEventBus::publish(ChunkEvent::GENERATED, pos, chunk);
+
+	for (auto& structurePos : work->mStructureChunks) { copyPendingStructures(structurePos); }
+	if (work->mDungeon) { work->mDungeon->loadChunk(pos.x, pos.y, pos.z); }
+
+	// the mesh built next includes everything above
+	work->mChunk = chunk;
+	work->mVolume.reset(new VoxelVolume(*chunk->mVolume));
+	chunk->mMeshNeedsUpdate = false;
+}
+
+// applies a finished chunk stage on the main thread
+ChunkApplyResult chunkPipelineApplyStage(ChunkWork* work)
+{
+	VolumeChunkWork* chunkWork = (VolumeChunkWork*)work;
+
+	// the chunks were thrown away while the work was running, its chunk may be gone
+	if (chunkWork->mGeneration != chunkWorldGeneration) { return ChunkApplyResult::FINISHED; }
+
+	if (work->mStage == ChunkStage::DECORATED)
+	{
+		// dungeon chunks are built from the maze, which may still be carved
+		if (chunkWork->mDungeon && !chunkWork->mDungeon->isMazeReady()) { return ChunkApplyResult::DEFERRED; }
+		installChunkWork(chunkWork);
+	}
+	else if (work->mStage == ChunkStage::MESHED)
+	{
+		// gpu pushes must happen on the main thread
+		VolumeChunk* chunk = chunkWork->mChunk;
+		if (VoxelFaceRenderer::isEnabled())
+		{
+			chunk->mFaces = std::move(chunkWork->mFaces);
+			VoxelFaceRenderer::upload(chunk->mFaces.get());
+		}
+		else { chunk->mMesh = std::move(chunkWork->mMesh); }
+		work->mStage = ChunkStage::UPLOADED;
+		ChunkEventBus::publish(ChunkEvent::MESHED, work->mPosition, chunk);
+		return ChunkApplyResult::FINISHED;
+	}
+	return ChunkApplyResult::CONTINUE;
+}
+
+void requestChunkMesh(const glm::ivec3& pos, VolumeChunk* chunk)
+{
+	// chunks still being generated are meshed once installed anyway
+	if (chunkPipeline->isPending(pos)) { return; }
+
+	VolumeChunkWork* work = new VolumeChunkWork(pos, ChunkStage::DECORATED);
+	work->mChunk = chunk;
+	work->mVolume.reset(new VoxelVolume(*chunk->mVolume));
+	work->mPlayerEdit = chunk->mPlayerEdited;
+	if (work->mPlayerEdit) { work->mPriority = JobPriority::HIGH; } // edits should show up right away
+	chunk->mMeshNeedsUpdate = false;
+	chunk->mPlayerEdited = false;
+	chunkPipeline->submit(work);
+}
+
+// call before throwing away mChunks. waiting work is dropped, work already running only touches its own volumes and is
+// dropped once it comes back
+void discardChunkWork()
+{
+	chunkWorldGeneration++;
+	chunkPrefetchPending.clear();
+	chunkPrefetched.clear();
+	if (chunkPipeline) { chunkPipeline->cancel([](ChunkWork* work) { return true; }); }
+}
+
+// how far ahead prefetched chunks may lie, in chunks. updated by updateChunkPrefetch
+int chunkPrefetchReach = 0;
+
+// what chunk work is scored against, updated by loadNewChunks
+glm::ivec3 chunkScoreCenter(std::numeric_limits<int>::max());
+glm::vec3 chunkScoreLook;
+glm::vec2 chunkScoreMoveDirection;
+int chunkScoreRenderDistance = 0;
+float chunkViewConeCos = 0.64f; // about half the horizontal fov, plus some slack for the size of a chunk
+
+// lower scores are generated and meshed first: the nearest chunks, those in view and those ahead of where the player
+// is heading. meshes of the player's own edits go before anything else
+float scoreChunkWork(const ChunkWork* work)
+{
+	const VolumeChunkWork* chunkWork = (const VolumeChunkWork*)work;
+	if (chunkWork->mPlayerEdit) { return -1.0f; }
+
+	// prefetched chunks only start when nothing in range is waiting, until the player comes close enough to request them
+	float prefetchPenalty = chunkPrefetchPending.count(work->mPosition) != 0 ? 1000.0f : 0.0f;
+
+	glm::vec3 toChunk(chunkToWorldPos(work->mPosition) + glm::vec3(8.0f) - glm::vec3(cx, 1.5f + cy, cz));
+	float distance = glm::length(toChunk);
+	float score = distance;
+
+	// anything outside of the view waits as if it were two chunks further away
+	if (distance > 16.0f && glm::dot(toChunk / distance, chunkScoreLook) < chunkViewConeCos) { score += 32.0f; }
+
+	// up to a chunk closer or further depending on how much it lies in the direction the player is moving
+	glm::vec2 flat(toChunk.x, toChunk.z);
+	if (glm::length(flat) > 0.0f) { score -= 16.0f * glm::dot(glm::normalize(flat), chunkScoreMoveDirection); }
+	return score + prefetchPenalty;
+}
+
+// rescores waiting chunk work once the player reaches another chunk or turns, and drops work that went out of range
+void updateChunkWorkPriorities(const glm::ivec3& curChunk)
+{
+	glm::vec3 look(glm::normalize(glm::vec3(lx, ly, lz)));
+	bool chunkChanged = curChunk != chunkScoreCenter;
+	bool rangeChanged = volumeRenderDistance != chunkScoreRenderDistance;
+	if (!chunkChanged && !rangeChanged && glm::dot(look, chunkScoreLook) >= 0.9f) { return; }
+
+	chunkScoreLook = look;
+	if (chunkChanged)
+	{
+		// the first call and teleports don't count as movement
+		glm::vec2 moved((float)curChunk.x - (float)chunkScoreCenter.x, (float)curChunk.z - (float)chunkScoreCenter.z);
+		float movedLength = glm::length(moved);
+		chunkScoreMoveDirection = movedLength > 0.0f && movedLength < 3.0f ? moved / movedLength : glm::vec2();
+		chunkScoreCenter = curChunk;
+	}
+	if (chunkChanged || rangeChanged)
+	{
+		chunkScoreRenderDistance = volumeRenderDistance;
+
+		// one chunk of slack, so walking back and forth over a chunk border doesn't keep dropping the same work
+		chunkPipeline->cancel([curChunk](ChunkWork* work)
+		{
+			const glm::ivec3& pos = work->mPosition;
+			if (std::abs(pos.x - curChunk.x) <= volumeRenderDistance + 1 && std::abs(pos.y - curChunk.y) <= 2 && std::abs(pos.z - curChunk.z) <= volumeRenderDistance + 1) { return false; }
+
+			// prefetched chunks may still lie ahead
+			if (chunkPrefetchPending.count(pos) != 0)
+			{
+				if (std::abs(pos.x - curChunk.x) <= chunkPrefetchReach && std::abs(pos.y - curChunk.y) <= 2 && std::abs(pos.z - curChunk.z) <= chunkPrefetchReach) { return false; }
+				chunkPrefetchPending.erase(pos);
+				return true;
+			}
+
+			// a dropped mesh update is requested again once the chunk is back in range
+			VolumeChunkWork* chunkWork = (VolumeChunkWork*)work;
+			if (chunkWork->mChunk)
+			{
+				chunkWork->mChunk->mMeshNeedsUpdate = true;
+				chunkWork->mChunk->mPlayerEdited |= chunkWork->mPlayerEdit;
+			}
+			return true;
+		});
+	}
+	chunkPipeline->reprioritize();
+
+	// prefetched chunks left far behind were never reached
+	if (chunkChanged || rangeChanged)
 	{
-		currentWave++;
-		waveEnemiesKilled = 0;
-		waveTransition = false;
-		NpcManager::unloadNpc(1);
-		UIWindowManager::getWindowByTitle("Shop")->setVisible(false);
+		for (auto it = chunkPrefetched.begin(); it != chunkPrefetched.end();)
+		{
+			if (std::abs(it->x - curChunk.x) > chunkPrefetchReach + volumeRenderDistance || std::abs(it->z - curChunk.z) > chunkPrefetchReach + volumeRenderDistance)
+			{
+				chunkPrefetchWasted++;
+				it = chunkPrefetched.erase(it);
+			}
+			else { ++it; }
+		}
 	}
 }
 
-#pragma endregion
+// requests chunks along the path the player is predicted to take, so fast movement (a charge dash covers 45 units a
+// second) doesn't outrun the loaded area. the prediction extrapolates the smoothed velocity, bent toward the look
+// direction since that is where the player steers. prefetched work runs after everything in range and at most
+// chunkPrefetchBudget chunks are in the pipeline at once
+void updateChunkPrefetch()
+{
+	// measured here, the frame scheduler may skip frames
+	long long now = Tools::currentTimeMillis();
+	float elapsed = chunkPrefetchLastUpdate == 0 ? 0.0f : (float)(now - chunkPrefetchLastUpdate) / 1000.0f;
+	chunkPrefetchLastUpdate = now;
 
-#pragma region Map Loading
+	glm::ivec3 playerVoxel(getPlayerPositionVoxelPos());
+	glm::ivec3 curChunk(getVoxelChunkPos(playerVoxel.x, playerVoxel.y, playerVoxel.z));
 
-std::vector<std::unique_ptr<Dungeon>> dungeons;
-Dungeon* activeDungeon = 0;
+	// the chunk the player stands on should always be there, count how often it isn't
+	glm::ivec3 groundChunk(getVoxelChunkPos(playerVoxel.x, playerVoxel.y - 1, playerVoxel.z));
+	auto ground = mChunks.find(groundChunk);
+	bool missing = ground == mChunks.end() || ground->second->mNeedsRegeneration;
+	if (missing && !chunkMissingUnderPlayer) { chunkMissingUnderPlayerEvents++; }
+	chunkMissingUnderPlayer = missing;
 
-Dungeon* getChunkDungeon(int x, int y, int z)
-{
-	for (auto& dungeon : dungeons)
+	glm::vec2 pos(cx, cz);
+	glm::vec2 moved(pos - chunkPrefetchLastPos);
+	chunkPrefetchLastPos = pos;
+	if (elapsed <= 0.0f) { return; }
+
+	// teleports aren't movement
+	if (glm::length(moved) > 64.0f) { chunkPrefetchVelocity = glm::vec2(); }
+	else { chunkPrefetchVelocity = glm::mix(chunkPrefetchVelocity, moved / elapsed, std::min(1.0f, elapsed * 8.0f)); }
+
+	float speed = glm::length(chunkPrefetchVelocity);
+	if (chunkPrefetchBudget <= 0 || speed < 4.0f) { chunkPrefetchReach = 0; return; }
+
+	glm::vec2 direction(chunkPrefetchVelocity / speed);
+	glm::vec2 look(lx, lz);
+	if (glm::length(look) > 0.0f)
 	{
-		if (dungeon->usesChunk(x, y, z)) { return dungeon.get(); }
+		look = glm::normalize(look);
+		if (glm::dot(direction, look) > 0.5f) { direction = glm::normalize(direction + look); }
 	}
-	return 0;
-}
-
-void initNoiseChunk(int x, int y, int z)
-{
-	BiomeAttributes* biome = registeredBiomes[getChunkBiome(x, z)].get();
 
-	int xxStart = x * 16;
-	int yyStart = y * 16;
-	int zzStart = z * 16;
+	float pathLength = speed * chunkPrefetchSeconds;
+	chunkPrefetchReach = (int)std::ceil(pathLength / 16.0f) + 1;
 
-	for (int xx = xxStart; xx < xxStart + 16; xx++)
+	// walk the path in half chunk steps, the chunks within render distance are already requested by loadNewChunks
+	for (float distance = 8.0f; distance <= pathLength && (int)chunkPrefetchPending.size() < chunkPrefetchBudget; distance += 8.0f)
 	{
-		for (int yy = yyStart; yy < yyStart + 16; yy++)
+		glm::vec2 point(pos + direction * distance);
+		glm::ivec3 column(getVoxelChunkPos((int)std::floor(point.x), 0, (int)std::floor(point.y)));
+		if (std::abs(column.x - curChunk.x) <= volumeRenderDistance && std::abs(column.z - curChunk.z) <= volumeRenderDistance) { continue; }
+
+		for (int y = curChunk.y - 1; y <= curChunk.y + 1 && (int)chunkPrefetchPending.size() < chunkPrefetchBudget; y++)
 		{
-			for (int zz = zzStart; zz < zzStart + 16; zz++)
-			{
-				double n = noise.noise((double)xx / biome->perlinScaleX, (double)yy / biome->perlinScaleY, (double)zz / biome->perlinScaleZ);
-				n += 1.0; // temporarily push all generation into positive space. physics fucks up at cy < 0
-				n *= 16.0;
-				if (yy <= (int)std::floor(n))
-				{
-					setVoxel(xx, yy, zz, Randomizer::getRandomInt(biome->redLow, biome->redHigh), Randomizer::getRandomInt(biome->greenLow, biome->greenHigh), Randomizer::getRandomInt(biome->blueLow, biome->blueHigh));
-				}
-			}
+			glm::ivec3 chunkPos(column.x, y, column.z);
+			auto chunk = mChunks.find(chunkPos);
+			if ((chunk != mChunks.end() && !chunk->second->mNeedsRegeneration) || chunkPipeline->isPending(chunkPos)) { continue; }
+
+			VolumeChunkWork* work = new VolumeChunkWork(chunkPos, ChunkStage::REQUESTED);
+			work->mDungeon = getChunkDungeon(chunkPos.x, chunkPos.y, chunkPos.z);
+			work->mPriority = JobPriority::LOW;
+			chunkPrefetchPending.insert(chunkPos);
+			chunkPipeline->submit(work);
+			chunkPrefetchRequested++;
 		}
 	}
 }
 
-// load portal heights
+// the highest solid voxel of the generated terrain in a column, without generating its chunks
+int getTerrainSurfaceHeight(const TerrainColumn& column, int x, int z)
+{
+	// only the band around the 2d height can go either way, search down through it for the first solid voxel
+	double surface = column.getHeight(x, z);
+	int height = std::max(0, (int)std::floor(surface - TERRAIN_DETAIL_BOUND));
+	for (int yy = (int)std::floor(surface + TERRAIN_DETAIL_BOUND); yy > height; yy--)
+	{
+		if (isTerrainSolid(column, x, yy, z)) { return yy; }
+	}
+	return height;
+}
+
+int getTerrainSurfaceHeight(int x, int z) { return getTerrainSurfaceHeight(*getTerrainColumn(floorDiv(x, 16), floorDiv(z, 16)), x, z); }
+
+// predicts the minimap color of a voxel column from the same biome and height function generateNoiseVolume uses,
+// shaded by the predicted height. called from the preview sampler threads
+void predictMinimapColumn(int x, int z, unsigned char* rgba)
+{
+	std::shared_ptr<const TerrainColumn> column = getTerrainColumn(floorDiv(x, 16), floorDiv(z, 16));
+	int localX = x - column->mPosition.x * 16;
+	int localZ = z - column->mPosition.y * 16;
+	int height = getTerrainSurfaceHeight(*column, x, z);
+
+	const glm::ivec3& low = column->mColorLow[localX][localZ];
+	const glm::ivec3& high = column->mColorHigh[localX][localZ];
+	float shade = 0.6f + (0.4f * height / 32.0f);
+	rgba[0] = (unsigned char)std::min(255.0f, ((low.r + high.r) / 2) * shade);
+	rgba[1] = (unsigned char)std::min(255.0f, ((low.g + high.g) / 2) * shade);
+	rgba[2] = (unsigned char)std::min(255.0f, ((low.b + high.b) / 2) * shade);
+	rgba[3] = 255;
+}
+
+// load portal heights, from the terrain layers so no chunks have to be generated on the spot
 void loadPortalChunks(Portal* portal)
 {
 	const glm::ivec3& basePos = portal->getPosition();
-	glm::ivec3 chunkPos = getVoxelChunkPos(basePos);
-	// current noise algo usage would generate max 3 chunk height noise
-	initNoiseChunk(chunkPos.x, 0, chunkPos.z);
-	initNoiseChunk(chunkPos.x, 1, chunkPos.z);
-	initNoiseChunk(chunkPos.x, 2, chunkPos.z);
 	// auto adjust height (maybe a setting to toggle in the future?)
-	portal->setPosition(glm::ivec3(basePos.x, getHighestVoxelAt(basePos.x, basePos.z) + 1, basePos.z));
+	portal->setPosition(glm::ivec3(basePos.x, getTerrainSurfaceHeight(basePos.x, basePos.z) + 1, basePos.z));
 }
 
 // load npc heights
 void loadNpcChunks(Npc* npc)
 {
 	const glm::vec3& basePos = npc->position;
-	glm::ivec3 chunkPos = getVoxelChunkPos(glm::ivec3((int)basePos.x, (int)basePos.y, (int)basePos.z));
-	// current noise algo usage would generate max 3 chunk height noise
-	initNoiseChunk(chunkPos.x, 0, chunkPos.z);
-	initNoiseChunk(chunkPos.x, 1, chunkPos.z);
-	initNoiseChunk(chunkPos.x, 2, chunkPos.z);
 	// auto adjust npc height (maybe a setting to toggle in the future?)
-	npc->position.y = (float)(getHighestVoxelAt((int)basePos.x, (int)basePos.z) + 1);
+	npc->position.y = (float)(getTerrainSurfaceHeight((int)basePos.x, (int)basePos.z) + 1);
 }
 
-void loadTown(const glm::ivec3& pos, const glm::ivec3& trainingGroundOffset, const std::string& name, bool npcs, int dungeonDifficulty)
+void loadTownDungeon(const glm::ivec3& pos, int dungeonDifficulty)
 {
 	// TODO: dungeon theme shouldn't be random
-	dungeons.push_back(std::unique_ptr<Dungeon>(new Dungeon(pos.x, pos.z, dungeonDifficulty, Randomizer::getRandomInt(1, 3))));
+	int themeId;
+	{
+		Randomizer::SeededScope seeded(RandomPurpose::TOWN, pos.x, 0, pos.z);
+		themeId = Randomizer::getRandomInt(1, 3);
+	}
+	addDungeon(new Dungeon(pos.x, pos.z, dungeonDifficulty, themeId));
+}
+
+void loadTown(const glm::ivec3& pos, const glm::ivec3& trainingGroundOffset, const std::string& name, bool npcs, int dungeonDifficulty)
+{
+	loadTownDungeon(pos, dungeonDifficulty);
 
 	Portal* portal = addPortal(pos.x + 1024 - 20, 0, pos.z + 1024 - 20, name + " Portal");
 	loadPortalChunks(portal);
@@ -6837,20 +8185,61 @@ void loadTown(const glm::ivec3& pos, const glm::ivec3& trainingGroundOffset, con
 	}
 }
 
+// how long frames have been too slow or fast enough to raise the render distance, and since the last change
+float renderDistanceSlowSeconds = 0.0f;
+float renderDistanceFastSeconds = 0.0f;
+float renderDistanceHoldSeconds = 0.0f;
+long long renderDistanceLastUpdate = 0;
+
+// holds the target frame rate by lowering the render distance when frames are slow or chunk generation can't keep up,
+// and raising it again once frames have been fast with nothing left to generate for a while. the two conditions are
+// far apart and both have to last, and every change is held for a bit, so it doesn't flip back and forth
+void updateRenderDistance()
+{
+	long long now = Tools::currentTimeMillis();
+	float elapsed = renderDistanceLastUpdate == 0 ? 0.0f : (float)(now - renderDistanceLastUpdate) / 1000.0f;
+	renderDistanceLastUpdate = now;
+
+	float frameMillis = FrameScheduler::getFrameMillis();
+	float targetMillis = FrameScheduler::getTargetFrameMillis();
+	int backlog = chunkPipeline->getWaitingCount();
+
+	// a full ring of missing chunks at the current distance is normal right after moving, more than two is falling behind
+	int ringChunks = (volumeRenderDistance * 2 + 1) * 4 * 3;
+	bool slow = frameMillis > targetMillis * 1.15f || backlog > ringChunks * 2;
+	bool fast = frameMillis < targetMillis * 0.75f && backlog == 0;
+
+	renderDistanceSlowSeconds = slow ? renderDistanceSlowSeconds + elapsed : 0.0f;
+	renderDistanceFastSeconds = fast ? renderDistanceFastSeconds + elapsed : 0.0f;
+	renderDistanceHoldSeconds += elapsed;
+	if (renderDistanceHoldSeconds < 2.0f) { return; }
+
+	int distance = volumeRenderDistance;
+	if (renderDistanceSlowSeconds >= 1.0f) { distance--; }
+	else if (renderDistanceFastSeconds >= 3.0f) { distance++; }
+	distance = std::max(volumeRenderDistanceMin, std::min(distance, volumeRenderDistanceMax));
+	if (distance == volumeRenderDistance) { return; }
+
+	printf("Render distance %d -> %d (frame %.1f ms, %d chunks waiting)\n", volumeRenderDistance, distance, frameMillis, backlog);
+	volumeRenderDistance = distance;
+	renderDistanceSlowSeconds = 0.0f;
+	renderDistanceFastSeconds = 0.0f;
+	renderDistanceHoldSeconds = 0.0f;
+}
+
+// the chunk the player was in when periodic dungeon spawns were last checked
+glm::ivec3 dungeonSpawnCheckChunk(std::numeric_limits<int>::max());
+
 void loadNewChunks()
 {
-	// check for periodic dungeon spawns in the dangerous wild
+	glm::ivec3 playerVoxel(getPlayerPositionVoxelPos());
+	glm::ivec3 curChunk(getVoxelChunkPos(playerVoxel.x, playerVoxel.y, playerVoxel.z));
+
+	// check for periodic dungeon spawns in the dangerous wild, once for every chunk the player enters
 	glm::vec3 playerPos(cx - 1024, 0, cz - 1024);
-	if (!dangerousWildBorder->containsPoint(playerPos))
+	if (curChunk != dungeonSpawnCheckChunk && !dangerousWildBorder->containsPoint(playerPos))
 	{
-		bool tooClose = false;
-		for (auto& dungeon : dungeons)
-		{
-			// distance complains without floating point vectors............
-			if (glm::distance(playerPos, glm::vec3(dungeon->getPosition())) < 4096) { tooClose = true; break; }
-		}
-
-		if (!tooClose && Randomizer::getRandomInt(0, 5) > 3)
+		if (!isDungeonNear(playerPos, 4096.0f) && Randomizer::getRandomInt(0, 5) > 3)
 		{
 			int difficulty = (int)std::floorf(glm::distance(glm::vec3(std::abs(playerPos.x), 0.0f, std::abs(playerPos.z)), glm::vec3()) / 2048.0f);
 			printf("Generating periodic wilderness dungeon at (%d, %d, %d) with difficulty %d\n", (int)playerPos.x, (int)playerPos.y, (int)playerPos.z, difficulty);
@@ -6858,13 +8247,11 @@ void loadNewChunks()
 		}
 	}
 
-	// handle new chunk loading / existing chunk processing
-	glm::ivec3 playerVoxel(getPlayerPositionVoxelPos());
-	glm::ivec3 curChunk(getVoxelChunkPos(playerVoxel.x, playerVoxel.y, playerVoxel.z));
+	dungeonSpawnCheckChunk = curChunk;
 
-	std::vector<glm::ivec3> treeChunks;
+	// handle new chunk loading / existing chunk processing
+	updateChunkWorkPriorities(curChunk);
 
-	// first perlin on the ground
 	for (int x = curChunk.x - volumeRenderDistance; x <= curChunk.x + volumeRenderDistance; x++)
 	{
 		for (int y = curChunk.y - 1; y <= curChunk.y + 1; y++)
@@ -6872,55 +8259,67 @@ void loadNewChunks()
 			for (int z = curChunk.z - volumeRenderDistance; z <= curChunk.z + volumeRenderDistance; z++)
 			{
 				// dynamically load terrain
-				auto chunk = mChunks.find(glm::ivec3(x, y, z));
+				glm::ivec3 pos(x, y, z);
+				auto chunk = mChunks.find(pos);
 				if (chunk == mChunks.end() || chunk->second->mNeedsRegeneration)
 				{
-					// don't auto-generate noise on dungeon terrain, use dungeon chunk generation instead
-					Dungeon* chunkDungeon = getChunkDungeon(x, y, z);
-					if (chunkDungeon) { chunkDungeon->loadChunk(x, y, z); continue; }
-
-					// load unloaded chunk near range, using perlin
-					initNoiseChunk(x, y, z);
-					// tree generation is determined by the biome attribute
-					BiomeAttributes* biome = registeredBiomes[getChunkBiome(x, z)].get();
-					if (biome->trees) { treeChunks.push_back(glm::ivec3(x, y, z)); }
+					// load unloaded chunk near range in the background, using perlin or the dungeon's chunk generation
+					if (chunkPipeline->isPending(pos))
+					{
+						// a prefetched chunk that isn't done yet is now needed like any other
+						if (chunkPrefetchPending.erase(pos) != 0)
+						{
+							chunkPrefetchLate++;
+							chunkPipeline->reprioritize();
+						}
+						continue;
+					}
+					VolumeChunkWork* work = new VolumeChunkWork(pos, ChunkStage::REQUESTED);
+					work->mDungeon = getChunkDungeon(x, y, z);
+					chunkPipeline->submit(work);
 				}
-				else { loadTreeVoxelsForChunk(x, y, z); }
+				else if (chunkPrefetched.erase(pos) != 0) { chunkPrefetchHits++; }
 			}
 		}
 	}
+}
 
-	// then randomly place some trees
-	for (auto c : treeChunks)
-	{
-		int xxStart = c.x * 16;
-		int yyStart = c.y * 16;
-		int zzStart = c.z * 16;
+// requests the chunks in range and along the predicted path, then applies finished chunk work with whatever is left of
+// the frame's budget
+void streamChunks(float budgetMillis)
+{
+	auto start = std::chrono::steady_clock::now();
+	updateRenderDistance();
+	loadNewChunks();
+	updateChunkPrefetch();
 
-		glm::ivec3 treeStart(xxStart + Randomizer::getRandomInt(3, 7), yyStart, zzStart + Randomizer::getRandomInt(3, 7));
-		// no tree spawns if ground doesn't exist on this chunk
-		if (getVoxel(treeStart).a != 0)
-		{
-			treeStart.y++;
-			bool airFound = false;
-			for (int i = 0; i < 15; i++)
-			{
-				if (getVoxel(treeStart).a != 0) { treeStart.y++; }
-				else { airFound = true; break; }
-			}
-			if (airFound) { setTree(treeStart.x, treeStart.y, treeStart.z); }
-		}
-	}
+	// the pipeline applies at least one result even without time left, so a slow frame still makes progress
+	float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	chunkPipeline->update(std::max(0.0f, budgetMillis - elapsed));
 }
 
+// the towns every world starts with
+struct TownDefinition
+{
+	glm::ivec3 position;
+	glm::ivec3 trainingGroundOffset;
+	const char* name;
+	int dungeonDifficulty;
+};
+
+const TownDefinition baseTowns[] =
+{
+	{ glm::ivec3(-1024, 0, -1024), glm::ivec3(), "Starting Town", 1 },
+	{ glm::ivec3(-2048, 0, -2048), glm::ivec3(1, 0, 0), "Town 1", 2 },
+	{ glm::ivec3(    0, 0, -2048), glm::ivec3(0, 0, 1), "Town 2", 3 },
+	{ glm::ivec3(-1024, 0,     0), glm::ivec3(-1, 0, 0), "Town 3", 4 },
+	{ glm::ivec3(-2048, 0,     0), glm::ivec3(0, 0, -1), "Town 4", 5 }
+};
+
 void loadGameMap()
 {
 	// load base towns
-	loadTown(glm::ivec3(-1024, 0, -1024), glm::ivec3(), "Starting Town", true, 1);
-	loadTown(glm::ivec3(-2048, 0, -2048), glm::ivec3(1, 0, 0), "Town 1", true, 2);
-	loadTown(glm::ivec3(    0, 0, -2048), glm::ivec3(0, 0, 1), "Town 2", true, 3);
-	loadTown(glm::ivec3(-1024, 0,     0), glm::ivec3(-1, 0, 0), "Town 3", true, 4);
-	loadTown(glm::ivec3(-2048, 0,     0), glm::ivec3(0, 0, -1), "Town 4", true, 5);
+	for (auto& town : baseTowns) { loadTown(town.position, town.trainingGroundOffset, town.name, true, town.dungeonDifficulty); }
 
 	// add land ownership start boundary (land ownership possible past this point)
 	landOwnershipBorder = new VisibleRegionBorder(glm::vec3(-2048, 0, -2048), glm::vec3(4096, 1024, 4096));
@@ -6937,6 +8336,7 @@ void loadGameMap()
 
 	// load surrounding chunks (before adjusting player y)
 	loadNewChunks();
+	chunkPipeline->finish();
 
 	// move player nicely to the proper height
 	glm::ivec3 pvox(getPlayerPositionVoxelPos());
@@ -6948,16 +8348,14 @@ void updateDungeons()
 	// check for dungeon entry/completion
 	if (!activeDungeon)
 	{
-		for (auto& dungeon : dungeons)
+		glm::ivec3 chunkPos(getVoxelChunkPos(getPlayerPositionVoxelPos()));
+		Dungeon* dungeon = getChunkDungeon(chunkPos.x, chunkPos.y, chunkPos.z);
+		if (dungeon && dungeon->isActivatable() && dungeon->isMazeReady())
 		{
-			if (dungeon->isPlayerInside() && dungeon->isActivatable())
-			{
-				activeDungeon = dungeon.get();
-				enablePhysicalBounds(activeDungeon->getWorldBoundingBox());
-				activeDungeon->setActivated(true);
-				currentWave = 1;
-				break;
-			}
+			activeDungeon = dungeon;
+			enablePhysicalBounds(activeDungeon->getWorldBoundingBox());
+			activeDungeon->setActivated(true);
+			currentWave = 1;
 		}
 	}
 	else // this can possibly go in the enemy death listener
@@ -6974,11 +8372,341 @@ void updateDungeons()
 
 #pragma endregion
 
+#pragma region World Pre-generation
+
+// -pregen stores the layers the player is usually around, the ones above and below are still generated while playing
+const int PREGEN_LOWEST_LAYER = -1;
+const int PREGEN_HIGHEST_LAYER = 3;
+
+// if a chunk of the x slab of the area from z0 to z1 isn't stored yet. dungeon chunks are built by their dungeon and
+// never stored
+bool isPregenSlabMissing(ChunkStore& store, int x, int z0, int z1)
+{
+	for (int z = z0; z <= z1; z++)
+	{
+		for (int y = PREGEN_LOWEST_LAYER; y <= PREGEN_HIGHEST_LAYER; y++)
+		{
+			if (!getChunkDungeon(x, y, z) && !store.contains(glm::ivec3(x, y, z))) { return true; }
+		}
+	}
+	return false;
+}
+
+// generates and decorates every chunk of a slab in parallel, the way the pipeline workers do. trees reaching into the
+// slabs next to it wait in structurePlacements
+void generatePregenSlab(int x, int z0, int z1, std::vector<std::unique_ptr<VolumeChunkWork>>& slab)
+{
+	std::vector<JobHandle> jobs;
+	for (int z = z0; z <= z1; z++)
+	{
+		for (int y = PREGEN_LOWEST_LAYER; y <= PREGEN_HIGHEST_LAYER; y++)
+		{
+			if (getChunkDungeon(x, y, z)) { continue; }
+
+			VolumeChunkWork* work = new VolumeChunkWork(glm::ivec3(x, y, z), ChunkStage::REQUESTED);
+			slab.push_back(std::unique_ptr<VolumeChunkWork>(work));
+			jobs.push_back(JobSystem::submit([work]()
+			{
+				chunkPipelineWorkerStage(work);
+				chunkPipelineWorkerStage(work);
+			}));
+		}
+	}
+	for (auto& job : jobs) { JobSystem::wait(job); }
+}
+
+// stores the chunks of a slab that aren't stored yet, once the slabs on both sides are decorated. returns how many
+// chunks were written, and the z of their columns in written
+int writePregenSlab(ChunkStore& store, std::vector<std::unique_ptr<VolumeChunkWork>>& slab, std::unordered_set<int>& written)
+{
+	std::vector<unsigned char> voxels(ChunkStore::CHUNK_BYTES);
+	int count = 0;
+	for (auto& work : slab)
+	{
+		const glm::ivec3& pos = work->mPosition;
+		VoxelVolume* volume = work->mVolume.get();
+
+		// trees of chunks decorated after this one
+		for (auto& placement : structurePlacements.take(pos)) { copyStructureSlice(volume, pos, placement, work->mStructures); }
+		if (store.contains(pos)) { continue; }
+
+		packChunkVoxels(volume, voxels.data());
+		if (store.write(pos, voxels.data()))
+		{
+			count++;
+			written.insert(pos.z);
+		}
+	}
+	return count;
+}
+
+// builds the minimap tiles of a slab's columns from the store, the top voxel of every column like the heightmaps do for
+// chunks in the world. columns with chunks just written always get theirs, the others only if the tile file has no real
+// tile for them, like after it was started over for another seed or a run was cut off before its tiles were built
+void submitPregenMinimapSlab(ChunkStore& store, MinimapTilePyramid& minimap, int x, int z0, int z1, const std::unordered_set<int>& written)
+{
+	std::vector<unsigned char> voxels(ChunkStore::CHUNK_BYTES);
+	unsigned char rgba[MinimapTilePyramid::TILE_BYTES];
+	for (int z = z0; z <= z1; z++)
+	{
+		unsigned int flags = 0;
+		if (written.count(z) == 0 && minimap.getTile(glm::ivec3(x, z, 0), rgba, &flags) && (flags & MinimapTilePyramid::TILE_REAL) != 0) { continue; }
+
+		// top layer first, a texel found in a higher layer stays
+		bool stored = false;
+		std::memset(rgba, 0, sizeof(rgba));
+		for (int y = PREGEN_HIGHEST_LAYER; y >= PREGEN_LOWEST_LAYER; y--)
+		{
+			if (!store.read(glm::ivec3(x, y, z), voxels.data())) { continue; }
+			stored = true;
+
+			for (int localZ = 0; localZ < 16; localZ++)
+			{
+				for (int localX = 0; localX < 16; localX++)
+				{
+					unsigned char* texel = rgba + ((localZ * 16) + localX) * 4;
+					if (texel[3] != 0) { continue; }
+
+					for (int localY = 15; localY >= 0; localY--)
+					{
+						const unsigned char* voxel = voxels.data() + (localX + (localY + localZ * ChunkStore::CHUNK_EDGE) * ChunkStore::CHUNK_EDGE) * 4;
+						if (voxel[3] != 0) { std::memcpy(texel, voxel, 4); break; }
+					}
+				}
+			}
+		}
+		if (stored) { minimap.submitColumn(glm::ivec2(x, z), rgba); }
+	}
+}
+
+// -pregen, generates the chunk columns from lower to upper (inclusive) into the chunk store along with their minimap
+// tiles, without opening a window. the area goes one x slab at a time, a slab being stored once the next one put its
+// trees in. stored chunks are skipped and only slabs next to missing ones are generated, so an interrupted run picks up
+// where it stopped
+void runWorldPregeneration(const glm::ivec2& lower, const glm::ivec2& upper)
+{
+	ChunkStore store("world.chunks", Randomizer::getWorldSeed(), true);
+	if (!store.isOpen()) { return; }
+	MinimapTilePyramid minimap("minimap.tiles", Randomizer::getWorldSeed());
+
+	printf("Pre-generating chunk columns [%d, %d] to [%d, %d], layers %d to %d, on %d workers\n", lower.x, lower.y, upper.x, upper.y, PREGEN_LOWEST_LAYER, PREGEN_HIGHEST_LAYER, JobSystem::getWorkerCount());
+	auto start = std::chrono::steady_clock::now();
+	auto secondsSince = [&start]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+	int generated = 0;
+	int written = 0;
+	std::vector<std::unique_ptr<VolumeChunkWork>> previous;
+	for (int x = lower.x; x <= upper.x + 1; x++)
+	{
+		std::vector<std::unique_ptr<VolumeChunkWork>> current;
+		if (x <= upper.x)
+		{
+			bool needed = isPregenSlabMissing(store, x, lower.y, upper.y);
+			if (!needed && x > lower.x) { needed = isPregenSlabMissing(store, x - 1, lower.y, upper.y); }
+			if (!needed && x < upper.x) { needed = isPregenSlabMissing(store, x + 1, lower.y, upper.y); }
+			if (needed)
+			{
+				generatePregenSlab(x, lower.y, upper.y, current);
+				generated += (int)current.size();
+			}
+		}
+
+		if (x > lower.x)
+		{
+			std::unordered_set<int> writtenColumns;
+			written += writePregenSlab(store, previous, writtenColumns);
+			store.flush();
+			submitPregenMinimapSlab(store, minimap, x - 1, lower.y, upper.y, writtenColumns);
+
+			// the tiles are read back from the file when playing, nothing here caches them
+			std::vector<glm::ivec3> rebuilt;
+			minimap.takeChangedTiles(rebuilt);
+
+			double seconds = secondsSince();
+			printf("Slab %d of %d: %d chunks written, %.0f chunks/s\n", x - lower.x, upper.x - lower.x + 1, written, generated / std::max(seconds, 0.001));
+		}
+		previous.swap(current);
+	}
+
+	// structures reaching out of the area or into slabs that were stored already, nothing takes them anymore
+	structurePlacements.clear();
+
+	minimap.finish();
+	double seconds = secondsSince();
+	printf("Generated %d chunks in %.1f s (%.0f chunks/s), wrote %d, %d chunks in %s\n", generated, seconds, generated / std::max(seconds, 0.001), written, store.getCount(), store.getPath().c_str());
+	size_t peak = ProcessMemory::getPeakBytes();
+	if (peak != 0) { printf("Peak memory %.1f MB\n", peak / (1024.0 * 1024.0)); }
+}
+
+#pragma endregion
+
+#pragma region Generation Benchmark
+
+// -genbench generates the same chunks on every run, so runs before and after a change to the generator compare
+const uint64_t GENBENCH_SEEDS[] = { 1, 42, 1337 };
+// corners of the chunk column patches generated for every seed, spread out to go through several biomes
+const glm::ivec2 GENBENCH_PATCHES[] = { glm::ivec2(0, 0), glm::ivec2(400, -300), glm::ivec2(-900, 1200) };
+const int GENBENCH_PATCH_SIZE = 8;
+const int GENBENCH_MAZES = 4; // per seed
+const int GENBENCH_DUNGEON_CELLS = 16; // dungeon chunks are this many cells of the first maze along both axes
+
+// microseconds every run of a stage took
+struct GenBenchStage
+{
+	const char* mName;
+	std::vector<double> mMicros;
+};
+
+// runs func for 0 to count - 1, on the job system if parallel
+void runGenBenchJobs(int count, bool parallel, const std::function<void(int)>& func)
+{
+	if (!parallel)
+	{
+		for (int i = 0; i < count; i++) { func(i); }
+		return;
+	}
+
+	std::vector<JobHandle> jobs;
+	jobs.reserve(count);
+	for (int i = 0; i < count; i++) { jobs.push_back(JobSystem::submit([&func, i]() { func(i); })); }
+	for (auto& job : jobs) { JobSystem::wait(job); }
+}
+
+// generates every seed's chunks once, stage by stage, and prints a json line for each stage and one for the pass
+void runGenBenchPass(int threads)
+{
+	bool parallel = threads > 1;
+	GenBenchStage noiseStage = { "noise" }, decorateStage = { "decorate" }, meshStage = { "mesh" }, mazeStage = { "maze" }, dungeonStage = { "dungeon" };
+	double seconds = 0.0;
+	int chunks = 0;
+	long long triangles = 0; // changes when the generator's output does, to tell slower code from more work
+
+	auto timeStage = [](GenBenchStage& stage, int index, const std::function<void()>& func)
+	{
+		auto start = std::chrono::steady_clock::now();
+		func();
+		stage.mMicros[index] += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	for (uint64_t seed : GENBENCH_SEEDS)
+	{
+		// everything derived from the seed starts over, so every pass does the same work
+		Randomizer::setWorldSeed(seed);
+		clearTerrainColumns();
+		buildStructureStamps();
+		structurePlacements.clear();
+
+		std::vector<std::unique_ptr<VolumeChunkWork>> works;
+		for (auto& patch : GENBENCH_PATCHES)
+		{
+			for (int x = patch.x; x < patch.x + GENBENCH_PATCH_SIZE; x++)
+			{
+				for (int z = patch.y; z < patch.y + GENBENCH_PATCH_SIZE; z++)
+				{
+					for (int y = PREGEN_LOWEST_LAYER; y <= PREGEN_HIGHEST_LAYER; y++) { works.push_back(std::unique_ptr<VolumeChunkWork>(new VolumeChunkWork(glm::ivec3(x, y, z), ChunkStage::REQUESTED))); }
+				}
+			}
+		}
+		int count = (int)works.size();
+		std::vector<long long> chunkTriangles(count);
+		std::vector<DungeonMaze> mazes(GENBENCH_MAZES);
+		const int dungeonChunks = GENBENCH_DUNGEON_CELLS * GENBENCH_DUNGEON_CELLS;
+		for (GenBenchStage* stage : { &noiseStage, &decorateStage, &meshStage }) { stage->mMicros.resize(stage->mMicros.size() + count); }
+		mazeStage.mMicros.resize(mazeStage.mMicros.size() + GENBENCH_MAZES);
+		dungeonStage.mMicros.resize(dungeonStage.mMicros.size() + dungeonChunks);
+		int first = (int)noiseStage.mMicros.size() - count;
+		int firstMaze = (int)mazeStage.mMicros.size() - GENBENCH_MAZES;
+		int firstDungeon = (int)dungeonStage.mMicros.size() - dungeonChunks;
+
+		auto start = std::chrono::steady_clock::now();
+
+		// the pipeline's worker stages, all chunks finish a stage before the next one starts
+		runGenBenchJobs(count, parallel, [&](int i) { timeStage(noiseStage, first + i, [&]() { chunkPipelineWorkerStage(works[i].get()); }); });
+		runGenBenchJobs(count, parallel, [&](int i) { timeStage(decorateStage, first + i, [&]() { chunkPipelineWorkerStage(works[i].get()); }); });
+		// trees of chunks decorated later, like installing does. counted with the chunk's decoration
+		runGenBenchJobs(count, parallel, [&](int i)
+		{
+			timeStage(decorateStage, first + i, [&]()
+			{
+				VolumeChunkWork* work = works[i].get();
+				for (auto& placement : structurePlacements.take(work->mPosition)) { copyStructureSlice(work->mVolume.get(), work->mPosition, placement, work->mStructures); }
+			});
+		});
+		runGenBenchJobs(count, parallel, [&](int i)
+		{
+			timeStage(meshStage, first + i, [&]()
+			{
+				Mesh mesh;
+				extractVolumeSurface(works[i]->mVolume.get(), &mesh);
+				chunkTriangles[i] = (long long)mesh.getNumIndices() / 3;
+			});
+		});
+
+		// dungeons, their mazes and then the chunks of the first one
+		runGenBenchJobs(GENBENCH_MAZES, parallel, [&](int i) { timeStage(mazeStage, firstMaze + i, [&]() { mazes[i].generate(dungeonMazeGenerator, Randomizer::getStreamKey(RandomPurpose::DUNGEON, i * 1024, 0, 0)); }); });
+		runGenBenchJobs(dungeonChunks, parallel, [&](int i)
+		{
+			timeStage(dungeonStage, firstDungeon + i, [&]()
+			{
+				glm::ivec3 pos(i % GENBENCH_DUNGEON_CELLS, 0, i / GENBENCH_DUNGEON_CELLS);
+				std::vector<StructurePlacement> pieces;
+				Dungeon::getChunkPieces(mazes[0], 1 + i % DUNGEON_THEME_COUNT, glm::ivec2(pos.x, pos.z), pos, pieces);
+				VoxelVolume volume(pos.x * 16, pos.y * 16, pos.z * 16, pos.x * 16 + 16, pos.y * 16 + 16, pos.z * 16 + 16);
+				std::vector<StructurePlacement> placed;
+				for (auto& piece : pieces) { copyStructureSlice(&volume, pos, piece, placed); }
+			});
+		});
+
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		chunks += count + dungeonChunks;
+		for (long long chunk : chunkTriangles) { triangles += chunk; }
+	}
+	structurePlacements.clear();
+
+	for (GenBenchStage* stage : { &noiseStage, &decorateStage, &meshStage, &mazeStage, &dungeonStage })
+	{
+		std::vector<double>& micros = stage->mMicros;
+		std::sort(micros.begin(), micros.end());
+		double total = 0.0;
+		for (double m : micros) { total += m; }
+		// nearest rank
+		auto percentile = [&micros](double p) { return micros[std::min(micros.size() - 1, (size_t)std::ceil(p / 100.0 * micros.size()) - 1)]; };
+		printf("{\"benchmark\":\"generation\",\"threads\":%d,\"stage\":\"%s\",\"samples\":%d,\"mean_us\":%.1f,\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}\n",
+			threads, stage->mName, (int)micros.size(), total / micros.size(), percentile(50.0), percentile(90.0), percentile(99.0), micros.back());
+	}
+	printf("{\"benchmark\":\"generation\",\"threads\":%d,\"stage\":\"total\",\"chunks\":%d,\"seconds\":%.3f,\"chunks_per_second\":%.1f,\"triangles\":%lld}\n", threads, chunks, seconds, chunks / seconds, triangles);
+}
+
+// -genbench, latency percentiles of every generation stage and chunks per second on one thread and on threads (all
+// hardware threads if 0). results are json lines on stdout, one per stage and pass, anything else printed doesn't start
+// with {
+void runGenerationBenchmark(int threads)
+{
+	if (threads <= 0) { threads = std::max(1, (int)std::thread::hardware_concurrency()); }
+
+	registerDefaultBiomes();
+	printf("{\"benchmark\":\"generation\",\"seeds\":[");
+	for (size_t i = 0; i < sizeof(GENBENCH_SEEDS) / sizeof(GENBENCH_SEEDS[0]); i++) { printf(i == 0 ? "%llu" : ",%llu", (unsigned long long)GENBENCH_SEEDS[i]); }
+	printf("],\"maze_generator\":\"%s\",\"threads\":[1,%d]}\n", DungeonMaze::getGeneratorName(dungeonMazeGenerator), threads);
+
+	runGenBenchPass(1);
+	if (threads > 1)
+	{
+		// the main thread runs jobs too while it waits for them
+		JobSystem::init(threads - 1);
+		runGenBenchPass(threads);
+		JobSystem::shutdown();
+	}
+}
+
+#pragma endregion
+
 // process and draw map
 void drawGameMap(float elapsed)
 {
 	// Draw ground
-	loadNewChunks();
+	RenderQueue::beginFrame(glm::vec3(cx, 1.5f + cy, cz));
+	FrameScheduler::run();
 	renderChunks();
 	updateDungeons();
 
@@ -7002,11 +8730,15 @@ void drawGameMap(float elapsed)
 	for (auto& i : spawnPoints)
 	{
 		// draw
-		glColor3f(0.5f, 0.5f, 0.5f);
-		glPushMatrix();
-		glTranslatef(i.get()->getPosition().x, i.get()->getPosition().y + 1, i.get()->getPosition().z);
-		glutWireCube(2.0f);
-		glPopMatrix();
+		EnemySpawnPoint* sp = i.get();
+		RenderQueue::submit(RenderPass::SOLID, RenderMaterial::WIREFRAME, sp->getPosition(), [sp]()
+		{
+			Renderer::color3f(0.5f, 0.5f, 0.5f);
+			Renderer::pushMatrix();
+			Renderer::translatef(sp->getPosition().x, sp->getPosition().y + 1, sp->getPosition().z);
+			Renderer::wireCube(2.0f);
+			Renderer::popMatrix();
+		});
 
 		// process
 		if (currentWave > 0 && getWaveEnemySpawnsRemaining() > 0)
@@ -7032,17 +8764,43 @@ void drawGameMap(float elapsed)
 			}
 		}
 	}
-	for (auto& i : enemies) { i.get()->update(elapsed); i.get()->draw(); }
+	for (auto& i : enemies)
+	{
+		Enemy* enemy = i.get();
+		enemy->update(elapsed);
+		RenderQueue::submit(RenderPass::SOLID, RenderMaterial::SOLID_SHAPE, enemy->getPosition(), [enemy]() { enemy->draw(); });
+	}
 	for (auto it = skillEffects.begin(); it != skillEffects.end(); )
 	{
-		it->get()->update(elapsed);
-		it->get()->draw();
-		if (it->get()->completed()) { it = skillEffects.erase(it); } else { it++; }
+		ISkillEffect* effect = it->get();
+		effect->update(elapsed);
+		if (effect->completed()) { it = skillEffects.erase(it); continue; }
+		RenderQueue::submit(RenderPass::TRANSLUCENT, RenderMaterial::LINES, effect->getCenter(), [effect]() { effect->draw(); });
+		it++;
+	}
+	for (auto& i : droppedItems)
+	{
+		DroppedItem* drop = i.get();
+		RenderQueue::submit(RenderPass::SOLID, RenderMaterial::ICON, drop->getPosition(), [drop]() { drop->draw(); });
+	}
+	for (auto& i : NpcManager::getNpcs())
+	{
+		Npc* npc = i.get();
+		RenderQueue::submit(RenderPass::SOLID, RenderMaterial::WIREFRAME, npc->position, [npc]() { npc->draw(); });
+	}
+	for (auto& i : portals)
+	{
+		Portal* portal = i.get();
+		RenderQueue::submit(RenderPass::TRANSLUCENT, RenderMaterial::SOLID_SHAPE, glm::vec3(portal->getPosition()), [portal]() { portal->draw(); });
+	}
+	for (auto& i : visibleRegionBorders)
+	{
+		VisibleRegionBorder* border = i.get();
+		RenderQueue::submit(RenderPass::TRANSLUCENT, RenderMaterial::REGION_BORDER, border->getNearestWallPoint(glm::vec3(cx, cy, cz)), [border]() { border->draw(); });
 	}
-	for (auto& i : droppedItems) { i.get()->draw(); }
-	for (auto& i : NpcManager::getNpcs()) { i->draw(); }
-	for (auto& i : portals) { i->draw(); }
-	for (auto& i : visibleRegionBorders) { i->draw(); }
+
+	// everything above is drawn here, before any of the updates below can remove it
+	RenderQueue::execute();
 
 	updateWaveTransition();
 	updatePlayer(elapsed);
@@ -7063,17 +8821,18 @@ void renderScene()
 {
 	long long currFrameTime = Tools::currentTimeMillis();
 	float elapsedFrameTime = (float)(currFrameTime - lastFrameTime) / 1000.0f;
+	FrameScheduler::beginFrame();
 
 	// Clear Color and Depth Buffers
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	// prepare 3d drawing
-	glLoadIdentity();
-	glPushMatrix();
+	Renderer::loadIdentity();
+	Renderer::pushMatrix();
 
 	// update camera view
 	//updateCamera(elapsedFrameTime);
-	gluLookAt(cx, 1.5f + cy, cz,
+	Renderer::lookAt(cx, 1.5f + cy, cz,
 		cx + lx, 1.5f + cy + ly, cz + lz,
 		0.0f, 1.0f, 0.0f);
 
@@ -7088,7 +8847,7 @@ void renderScene()
 	glGetIntegerv(GL_VIEWPORT, viewport);
 
 	// switch to 2d drawing mode
-	glPopMatrix();
+	Renderer::popMatrix();
 	setOrthographicProjection();
 
 	// draw enemy hp bars
@@ -7098,11 +8857,11 @@ void renderScene()
 		if ((int)barPos.z != 1)
 		{
 			barPos.y = windowHeight - barPos.y;
-			glColor3f(1.0f, 0.0f, 0.0f);
+			Renderer::color3f(1.0f, 0.0f, 0.0f);
 			//printf("Bar pos: %d, %d, %d\n", (int)barWinX, (int)barWinY, (int)barWinZ);
-			glColor4f(1.0f, 0.0f, 0.0f, 0.2f);
+			Renderer::color4f(1.0f, 0.0f, 0.0f, 0.2f);
 			Renderer::drawQuad2D((int)barPos.x - 25, (int)barPos.y, 50, 15);
-			glColor4f(1.0f, 0.0f, 0.0f, 0.8f);
+			Renderer::color4f(1.0f, 0.0f, 0.0f, 0.8f);
 			Renderer::drawQuad2D((int)barPos.x - 25, (int)barPos.y, calcProgressWidth(enemy->getHP(), enemy->getMaxHP(), 50), 15);
 		}
 	}
@@ -7110,7 +8869,7 @@ void renderScene()
 	// draw crosshair
 	int windowCenterX = windowWidth / 2;
 	int windowCenterY = windowHeight / 2;
-	glColor4f(0.5f, 0.5f, 0.5f, 0.75f);
+	Renderer::color4f(0.5f, 0.5f, 0.5f, 0.75f);
 	Renderer::drawQuad2D(windowCenterX - 25, windowCenterY - 2, 50, 4);
 	Renderer::drawQuad2D(windowCenterX - 2, windowCenterY - 25, 4, 50);
 
@@ -7124,7 +8883,7 @@ void renderScene()
 	}
 
 	// display various stats
-	glColor3f(0.0f, 0.0f, 0.0f);
+	Renderer::color3f(0.0f, 0.0f, 0.0f);
 	//drawLoadedMapleMapStatistics();
 	Renderer::renderString(10, 30, RenderFont::BITMAP_HELVETICA_18, fpsStr);
 
@@ -7147,13 +8906,21 @@ void renderScene()
 		Renderer::renderString(10, 130, RenderFont::BITMAP_HELVETICA_18, "Waves Disabled");
 	}
 
-	std::string vxStr = "Active Chunks: " + std::to_string(mChunks.size()) + " | Extracting: " + std::to_string(activeSurfaceExtractionThreads) + " | Render Dist: " + std::to_string(volumeRenderDistance);
+	char overdrawStr[16];
+	sprintf_s(overdrawStr, "%.2f", RenderQueue::getOverdraw());
+	std::string rbStr = "UI Quads: " + std::to_string(Renderer::getFrameQuadCount()) + " | Flushes: " + std::to_string(Renderer::getFrameFlushCount()) + " | Draw Items: " + std::to_string(RenderQueue::getItemCount()) + " | State Changes: " + std::to_string(RenderQueue::getStateChangeCount()) + " | Overdraw: " + overdrawStr + "x";
+	Renderer::renderString(5, 170, RenderFont::BITMAP_HELVETICA_18, rbStr);
+	std::string vxStr = "Active Chunks: " + std::to_string(mChunks.size()) + " | Pipeline: " + std::to_string(chunkPipeline->getPendingCount()) + " (" + std::to_string(chunkPipeline->getWaitingCount()) + " waiting, " + std::to_string(chunkPipeline->getAppliedCount()) + " applied, " + std::to_string(chunkPipeline->getCancelledCount()) + " cancelled)" + " | Render Dist: " + std::to_string(volumeRenderDistance) + " (" + std::to_string(volumeRenderDistanceMin) + "-" + std::to_string(volumeRenderDistanceMax) + ")";
 	Renderer::renderString(5, 190, RenderFont::BITMAP_HELVETICA_18, vxStr);
+	int prefetchOutcomes = chunkPrefetchHits + chunkPrefetchLate + chunkPrefetchWasted;
+	std::string pfStr = "Prefetch: " + std::to_string(chunkPrefetchPending.size()) + " / " + std::to_string(chunkPrefetchBudget) + " | Requested: " + std::to_string(chunkPrefetchRequested) + " | Hit Rate: " + std::to_string(prefetchOutcomes == 0 ? 0 : chunkPrefetchHits * 100 / prefetchOutcomes) + "% (" + std::to_string(chunkPrefetchLate) + " late, " + std::to_string(chunkPrefetchWasted) + " wasted) | Missing Under Player: " + std::to_string(chunkMissingUnderPlayerEvents);
 	glm::ivec3 playerVoxel(getPlayerPositionVoxelPos());
 	glm::ivec3 playerChunkPos(getVoxelChunkPos(playerVoxel.x, playerVoxel.y, playerVoxel.z));
-	VolumeChunk* playerChunk = mChunks[playerChunkPos].get();
-	std::string vpStr = "Player Voxel Pos: " + to_string(playerVoxel) + " | Chunk: " + to_string(playerChunkPos) + " | Owner: " + (playerChunk->mOwnerId == 1 ? "You" : "None");
-	if (playerChunk->mOwnerId != 0)
+	// the chunk may still be in the generation pipeline
+	auto playerChunkIt = mChunks.find(playerChunkPos);
+	VolumeChunk* playerChunk = playerChunkIt == mChunks.end() ? 0 : playerChunkIt->second.get();
+	std::string vpStr = "Player Voxel Pos: " + to_string(playerVoxel) + " | Chunk: " + to_string(playerChunkPos) + " | Owner: " + (playerChunk == 0 ? "Loading" : playerChunk->mOwnerId == 1 ? "You" : "None");
+	if (playerChunk != 0 && playerChunk->mOwnerId != 0)
 	{
 		long long millis = playerChunk->getRemainingOwnershipTime();
 		if (millis < 0) { millis = 0; }
@@ -7173,29 +8940,44 @@ void renderScene()
 	Renderer::renderString(5, 230, RenderFont::BITMAP_HELVETICA_18, cpStr);
 	std::string veStr = "VEdit :: Air: (" + to_string(voxelEditAir) + ") | Solid: (" + to_string(voxelEditSolid) + ")";
 	Renderer::renderString(5, 250, RenderFont::BITMAP_HELVETICA_18, veStr);
+	JobSystem::sampleUtilization();
+	std::string jbStr = "Jobs Queued: " + std::to_string(JobSystem::getQueuedJobCount()) + " | Workers:";
+	for (int i = 0; i < JobSystem::getWorkerCount(); i++) { jbStr += " " + std::to_string((int)(JobSystem::getWorkerUtilization(i) * 100.0f)) + "%"; }
+	Renderer::renderString(5, 270, RenderFont::BITMAP_HELVETICA_18, jbStr);
+	Renderer::renderString(5, 290, RenderFont::BITMAP_HELVETICA_18, pfStr);
+	char frameStr[64];
+	sprintf_s(frameStr, "Frame: %.1f / %.1f ms | Task Budget: %.1f ms |", FrameScheduler::getFrameMillis(), FrameScheduler::getTargetFrameMillis(), FrameScheduler::getTaskBudgetMillis());
+	std::string ftStr = frameStr;
+	for (int i = 0; i < FrameScheduler::getTaskCount(); i++)
+	{
+		char taskStr[64];
+		sprintf_s(taskStr, " %s %.2f", FrameScheduler::getTaskName(i).c_str(), FrameScheduler::getTaskAverageMillis(i));
+		ftStr += taskStr;
+	}
+	Renderer::renderString(5, 310, RenderFont::BITMAP_HELVETICA_18, ftStr);
 
 	// render stat bars at the bottom
 
 	// hp bar
-	glColor4f(1.0f, 0.0f, 0.0f, 0.5f);
+	Renderer::color4f(1.0f, 0.0f, 0.0f, 0.5f);
 	Renderer::drawQuad2D(0, windowHeight - 50, windowWidth / 2, 25);
-	glColor4f(1.0f, 0.0f, 0.0f, 0.8f);
+	Renderer::color4f(1.0f, 0.0f, 0.0f, 0.8f);
 	Renderer::drawQuad2D(0, windowHeight - 50, calcProgressWidth(playerEntity->getHP(), playerEntity->getMaxHP(), windowWidth / 2), 25);
-	glColor3f(0.0f, 0.0f, 0.0f);
+	Renderer::color3f(0.0f, 0.0f, 0.0f);
 	Renderer::renderString(windowWidth / 4, windowHeight - 30, RenderFont::BITMAP_HELVETICA_18, std::string("HP: ") + std::to_string(playerEntity->getHP()) + " / " + std::to_string(playerEntity->getMaxHP()));
 	// mp bar
-	glColor4f(0.0f, 0.0f, 1.0f, 0.5f);
+	Renderer::color4f(0.0f, 0.0f, 1.0f, 0.5f);
 	Renderer::drawQuad2D(windowWidth / 2, windowHeight - 50, windowWidth / 2, 25);
-	glColor4f(0.0f, 0.0f, 1.0f, 0.8f);
+	Renderer::color4f(0.0f, 0.0f, 1.0f, 0.8f);
 	Renderer::drawQuad2D(windowWidth / 2, windowHeight - 50, calcProgressWidth(playerEntity->getMP(), playerEntity->getMaxMP(), windowWidth / 2), 25);
-	glColor3f(0.0f, 0.0f, 0.0f);
+	Renderer::color3f(0.0f, 0.0f, 0.0f);
 	Renderer::renderString((windowWidth / 2) + (windowWidth / 4), windowHeight - 30, RenderFont::BITMAP_HELVETICA_18, std::string("MP: ") + std::to_string(playerEntity->getMP()) + " / " + std::to_string(playerEntity->getMaxMP()));
 	// exp bar
-	glColor4f(0.0f, 1.0f, 0.0f, 0.5f);
+	Renderer::color4f(0.0f, 1.0f, 0.0f, 0.5f);
 	Renderer::drawQuad2D(0, windowHeight - 25, windowWidth, 25);
-	glColor4f(0.0f, 1.0f, 0.0f, 0.8f);
+	Renderer::color4f(0.0f, 1.0f, 0.0f, 0.8f);
 	Renderer::drawQuad2D(0, windowHeight - 25, calcProgressWidth(playerEXP, getEXPNeeded(playerLevel), windowWidth), 25);
-	glColor3f(0.0f, 0.0f, 0.0f);
+	Renderer::color3f(0.0f, 0.0f, 0.0f);
 	Renderer::renderString(windowWidth / 2, windowHeight - 5, RenderFont::BITMAP_HELVETICA_18, std::string("EXP: ") + std::to_string(playerEXP) + " / " + std::to_string(getEXPNeeded(playerLevel)));
 	Renderer::renderString(25, windowHeight - 5, RenderFont::BITMAP_HELVETICA_18, std::string("Level: ") + std::to_string(playerLevel));
 
@@ -7217,6 +8999,7 @@ void renderScene()
 	restorePerspectiveProjection();
 
 	// flip back buffer to screen
+	Renderer::endFrame();
 	glutSwapBuffers();
 	lastFrameTime = currFrameTime;
 }
@@ -7501,8 +9284,112 @@ void mouseMovePassive(int x, int y)
 
 #pragma endregion
 
+// the seed of the world in world.chunks and minimap.tiles, shared by the game and -pregen
+const char* WORLD_SEED_FILE = "world.seed";
+
+// options both the game and the generation tools take
+void parseWorldOptions(int argc, char** argv)
+{
+	// -seed <number> generates the same world as any earlier run with that seed. without it the seed of the last run is
+	// kept, so the stored chunks and explored map stay valid, and a random one is picked the first time
+	bool seedGiven = false;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) != "-seed") { continue; }
+		Randomizer::setWorldSeed(std::strtoull(argv[i + 1], 0, 10));
+		seedGiven = true;
+	}
+
+	unsigned long long savedSeed = 0;
+	std::ifstream seedIn(WORLD_SEED_FILE);
+	bool seedSaved = (bool)(seedIn >> savedSeed);
+	seedIn.close();
+	if (!seedGiven && seedSaved) { Randomizer::setWorldSeed(savedSeed); }
+	else if (!seedSaved || savedSeed != Randomizer::getWorldSeed())
+	{
+		std::ofstream seedOut(WORLD_SEED_FILE);
+		seedOut << (unsigned long long)Randomizer::getWorldSeed() << "\n";
+		if (!seedOut) { printf("Failed to save the world seed to %s\n", WORLD_SEED_FILE); }
+	}
+	printf("World seed %llu\n", (unsigned long long)Randomizer::getWorldSeed());
+	// -maze <walk|backtracker|wilson> picks how dungeon mazes are carved
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) != "-maze") { continue; }
+		for (int g = 0; g < MAZE_GENERATOR_COUNT; g++) { if (std::string(argv[i + 1]) == DungeonMaze::getGeneratorName((MazeGenerator)g)) { dungeonMazeGenerator = (MazeGenerator)g; } }
+	}
+}
+
+// the generation tools, which run without opening a window. returns the exit code, or -1 if none was asked for
+int runGenerationTool(int argc, char** argv)
+{
+	// -biometest checks the biome lookup, the exit code is 1 if it found a mismatch
+	for (int i = 1; i < argc; i++) { if (std::string(argv[i]) == "-biometest") { registerDefaultBiomes(); return runBiomeTest() == 0 ? 0 : 1; } }
+	// -noisebench measures the noise kernels and chunk generation and exits without opening a window
+	for (int i = 1; i < argc; i++) { if (std::string(argv[i]) == "-noisebench") { runNoiseBenchmark(); return 0; } }
+	// -genbench [threads] measures every chunk generation stage and exits
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) != "-genbench") { continue; }
+		runGenerationBenchmark(i + 1 < argc ? std::atoi(argv[i + 1]) : 0);
+		return 0;
+	}
+	// -pregen <radius> around the start chunk or -pregen <x0> <z0> <x1> <z1> fills the chunk store and exits
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) != "-pregen") { continue; }
+
+		auto isNumber = [](const char* arg) { char* end; std::strtol(arg, &end, 10); return *arg != 0 && *end == 0; };
+		glm::ivec2 start(floorDiv((int)std::floorf(cx), 16), floorDiv((int)std::floorf(cz), 16));
+		int radius = std::atoi(argv[i + 1]);
+		glm::ivec2 lower(start - radius), upper(start + radius);
+		if (i + 4 < argc && isNumber(argv[i + 2]) && isNumber(argv[i + 3]) && isNumber(argv[i + 4]))
+		{
+			lower = glm::ivec2(std::atoi(argv[i + 1]), std::atoi(argv[i + 2]));
+			upper = glm::ivec2(std::atoi(argv[i + 3]), std::atoi(argv[i + 4]));
+		}
+
+		JobSystem::init();
+		registerDefaultBiomes();
+		buildStructureStamps();
+		for (auto& town : baseTowns) { loadTownDungeon(town.position, town.dungeonDifficulty); }
+		runWorldPregeneration(glm::min(lower, upper), glm::max(lower, upper));
+		JobSystem::shutdown();
+		return 0;
+	}
+	return -1;
+}
+
+#ifdef WINGS_HEADLESS
+// wings-pregen, the generation tools on their own. nothing they run calls into glut, which is only delay loaded, so no
+// window system is needed
 int main(int argc, char** argv)
 {
+	parseWorldOptions(argc, argv);
+	int result = runGenerationTool(argc, argv);
+	if (result != -1) { return result; }
+
+	printf("usage: wings-pregen [-seed <number>] [-maze <walk|backtracker|wilson>] <tool>\n");
+	printf("  the seed is kept in world.seed for the next run and the game\n");
+	printf("  -pregen <radius> | -pregen <x0> <z0> <x1> <z1>  fills world.chunks and minimap.tiles\n");
+	printf("  -genbench [threads]  latency of every generation stage, as json lines\n");
+	printf("  -noisebench  speed of the noise kernels\n");
+	printf("  -biometest  checks the biome lookup against a brute force search\n");
+	return 1;
+}
+#else
+int main(int argc, char** argv)
+{
+	// -vertexpulling selects the gl 4.3 chunk renderer, which falls back to the fixed function one when unsupported.
+	// the default compatibility context is used either way since everything else still draws in immediate mode
+	bool vertexPulling = false;
+	for (int i = 1; i < argc; i++) { if (std::string(argv[i]) == "-vertexpulling") { vertexPulling = true; } }
+	// -prefetch <chunks> sets how many chunks ahead of the player may be generated at once, 0 turns it off
+	for (int i = 1; i + 1 < argc; i++) { if (std::string(argv[i]) == "-prefetch") { chunkPrefetchBudget = std::max(0, std::atoi(argv[i + 1])); } }
+	parseWorldOptions(argc, argv);
+	int toolResult = runGenerationTool(argc, argv);
+	if (toolResult != -1) { return toolResult; }
+
 	// init GLUT and create Window
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA);
@@ -7522,6 +9409,8 @@ int main(int argc, char** argv)
 	glutPassiveMotionFunc(mouseMovePassive);
 
 	// OpenGL init
+	Renderer::init();
+	if (vertexPulling && VoxelFaceRenderer::init()) { RenderQueue::setMaterialState(RenderMaterial::VOXEL_MESH, VoxelFaceRenderer::begin, VoxelFaceRenderer::end); }
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -7617,12 +9506,12 @@ int main(int argc, char** argv)
 	loadConfig();
 
 	// register biome attributes
-	registerBiomeAttributes(BiomeType::FOREST, 128, 128, 128, 0, 30, 100, 255, 0, 30, true);
-	registerBiomeAttributes(BiomeType::PLAIN, 1024, 32, 1024, 0, 30, 100, 255, 0, 30, true);
-	registerBiomeAttributes(BiomeType::ICE, 512, 64, 512, 0, 198, 239, 239, 255, 255, false);
-	registerBiomeAttributes(BiomeType::JUNGLE, 256, 256, 256, 0, 15, 0, 75, 0, 15, true);
-	registerBiomeAttributes(BiomeType::DESERT, 2048, 128, 2048, 232, 232, 232, 232, 155, 221, false);
-	registerBiomeAttributes(BiomeType::MOUNTAINS, 32, 2048, 32, 112, 183, 94, 153, 68, 111, false);
+	registerDefaultBiomes();
+	buildStructureStamps();
+
+	// chunks stored by -pregen for this seed are read instead of generated
+	chunkStore.reset(new ChunkStore("world.chunks", Randomizer::getWorldSeed(), false));
+	if (!chunkStore->isOpen()) { chunkStore.reset(); }
 
 	// load enemy drop entries (currently assumes all drops are global)
 	EnemyInformationProvider::addDropEntry(1492001, 100000);
@@ -7638,6 +9527,25 @@ int main(int argc, char** argv)
 	EnemyInformationProvider::addDropEntry(2000012, 300000, 1, 3);
 	EnemyInformationProvider::addDropEntry(2100000, 50000);
 
+	// open the explored world map tiles
+	minimapPyramid.reset(new MinimapTilePyramid("minimap.tiles", Randomizer::getWorldSeed()));
+	minimapPreview.reset(new MinimapPreviewSampler(predictMinimapColumn, [](const glm::ivec3& tile, const unsigned char* rgba) { minimapPyramid->submitPredictedTile(tile, rgba); }, std::max(1, (int)std::thread::hardware_concurrency() / 2)));
+
+	// start chunk generation
+	JobSystem::init();
+	ChunkEventBus::subscribe(ChunkEvent::ENTERED_RANGE, &chunkVisitListener);
+	ChunkEventBus::subscribe(ChunkEvent::LEFT_RANGE, &chunkVisitListener);
+	ChunkEventBus::subscribe(ChunkEvent::GENERATED, &heightmapChunkListener);
+	ChunkEventBus::subscribe(ChunkEvent::CREATED, &structurePlacementListener);
+	ChunkEventBus::subscribe(ChunkEvent::GENERATED, &structurePlacementListener);
+	chunkPipeline.reset(new ChunkPipeline(chunkPipelineWorkerStage, chunkPipelineApplyStage, scoreChunkWork));
+
+	// main thread work that is spread over frames
+	FrameScheduler::addTask("Streaming", FrameTaskPriority::HIGH, 1.0f + volumeGenerationFrameBudget, streamChunks);
+	FrameScheduler::addTask("AI", FrameTaskPriority::NORMAL, 1.0f, [](float budgetMillis) { JobSystem::runMainThreadJobs(budgetMillis); }); // pathfinding results
+	FrameScheduler::addTask("Map Tiles", FrameTaskPriority::LOW, 1.0f, updateMinimapPyramid);
+	FrameScheduler::addTask("Autosave", FrameTaskPriority::LOW, 2.0f, [](float budgetMillis) { saveConfig(); }, 300.0f);
+
 	// load map
 	loadGameMap();
 
@@ -7646,4 +9554,5 @@ int main(int argc, char** argv)
 	glutMainLoop();
 
 	return 1;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
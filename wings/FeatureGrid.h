@@ -0,0 +1,67 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "VecUtil.h"
+
+// finds world features (dungeons, portals, ...) by position without going through all of them. a feature is listed in
+// every cell of a uniform grid its footprint overlaps, so a lookup only looks at the features sharing a cell with what
+// it asks about. positions are in whatever unit the caller uses, as long as it always uses the same one
+template <typename T>
+class FeatureGrid
+{
+private:
+	int mCellSize;
+	std::unordered_map<glm::ivec2, std::vector<T*>, KeyHash_GLMIVec2, KeyEqual_GLMIVec2> mCells;
+	std::vector<T*> mEmpty;
+	int mCount = 0;
+
+	glm::ivec2 getCell(const glm::ivec2& pos) const { return glm::ivec2(floorDiv(pos.x, mCellSize), floorDiv(pos.y, mCellSize)); }
+
+public:
+	FeatureGrid(int cellSize) : mCellSize(cellSize) {}
+
+	// the footprint goes from lower to upper, inclusive
+	void insert(T* feature, const glm::ivec2& lower, const glm::ivec2& upper)
+	{
+		glm::ivec2 lowerCell(getCell(lower));
+		glm::ivec2 upperCell(getCell(upper));
+		for (int x = lowerCell.x; x <= upperCell.x; x++)
+		{
+			for (int y = lowerCell.y; y <= upperCell.y; y++) { mCells[glm::ivec2(x, y)].push_back(feature); }
+		}
+		mCount++;
+	}
+
+	// the features sharing a cell with pos, their footprints don't have to contain it
+	const std::vector<T*>& getCandidates(const glm::ivec2& pos) const
+	{
+		auto it = mCells.find(getCell(pos));
+		return it == mCells.end() ? mEmpty : it->second;
+	}
+
+	// calls visit for the features sharing a cell with the area from lower to upper until it returns true, features
+	// spanning several of those cells may be visited more than once. returns true if visit did
+	bool findInArea(const glm::ivec2& lower, const glm::ivec2& upper, const std::function<bool(T* feature)>& visit) const
+	{
+		glm::ivec2 lowerCell(getCell(lower));
+		glm::ivec2 upperCell(getCell(upper));
+		for (int x = lowerCell.x; x <= upperCell.x; x++)
+		{
+			for (int y = lowerCell.y; y <= upperCell.y; y++)
+			{
+				auto it = mCells.find(glm::ivec2(x, y));
+				if (it == mCells.end()) { continue; }
+				for (T* feature : it->second) { if (visit(feature)) { return true; } }
+			}
+		}
+		return false;
+	}
+
+	int getCount() const { return mCount; }
+	int getCellCount() const { return (int)mCells.size(); }
+};
\ No newline at end of file
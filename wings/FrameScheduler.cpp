@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "FrameScheduler.h"
+
+struct FrameTask
+{
+	std::string mName;
+	FrameTaskPriority mPriority;
+	float mSliceMillis;
+	FrameScheduler::Task mTask;
+	float mIntervalSeconds;
+
+	std::chrono::steady_clock::time_point mLastRun;
+	float mCarryMillis = 0.0f;
+	float mLastMillis = 0.0f;
+	float mAverageMillis = 0.0f;
+	int mSkipCount = 0;
+};
+
+const int FRAME_TASK_MAX_CARRY_SLICES = 3; // unused time saved up, at most
+const int FRAME_TASK_MAX_SKIPS = 60; // normal and low priority tasks run at least this often, even on slow frames
+const float FRAME_TASK_MIN_HIGH_SLICE = 0.25f; // of its slice, what a high priority task gets every frame
+
+std::vector<FrameTask> frameTasks;
+std::vector<int> frameTaskOrder; // by priority, then in the order they were added
+float frameTargetMillis = 1000.0f / 60.0f;
+
+std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+float frameMillis = 0.0f;
+float frameTaskMillis = 0.0f; // time all tasks took during the current frame
+float frameOtherMillis = 0.0f; // smoothed time of everything besides the tasks
+float frameTaskBudget = 0.0f;
+
+float millisSince(const std::chrono::steady_clock::time_point& start) { return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(); }
+
+int FrameScheduler::addTask(const std::string& name, FrameTaskPriority priority, float sliceMillis, const Task& task, float intervalSeconds)
+{
+	FrameTask frameTask;
+	frameTask.mName = name;
+	frameTask.mPriority = priority;
+	frameTask.mSliceMillis = sliceMillis;
+	frameTask.mTask = task;
+	frameTask.mIntervalSeconds = intervalSeconds;
+	frameTask.mLastRun = std::chrono::steady_clock::now();
+	frameTasks.push_back(frameTask);
+
+	int index = (int)frameTasks.size() - 1;
+	frameTaskOrder.push_back(index);
+	std::stable_sort(frameTaskOrder.begin(), frameTaskOrder.end(), [](int a, int b) { return frameTasks[a].mPriority < frameTasks[b].mPriority; });
+	return index;
+}
+
+void FrameScheduler::setTargetFrameMillis(float millis) { frameTargetMillis = millis; }
+
+float FrameScheduler::getTargetFrameMillis() { return frameTargetMillis; }
+
+void FrameScheduler::beginFrame()
+{
+	auto now = std::chrono::steady_clock::now();
+	float lastFrameMillis = std::chrono::duration<float, std::milli>(now - frameStart).count();
+	frameStart = now;
+
+	// smoothed, a single slow frame (like a hitch while loading) shouldn't starve the tasks for long
+	frameMillis += (lastFrameMillis - frameMillis) * 0.1f;
+	frameOtherMillis += (std::max(0.0f, lastFrameMillis - frameTaskMillis) - frameOtherMillis) * 0.1f;
+	frameTaskMillis = 0.0f;
+}
+
+void FrameScheduler::run()
+{
+	auto runStart = std::chrono::steady_clock::now();
+	frameTaskBudget = std::max(0.0f, frameTargetMillis - frameOtherMillis);
+
+	for (int index : frameTaskOrder)
+	{
+		FrameTask& task = frameTasks[index];
+		if (task.mIntervalSeconds > 0.0f && millisSince(task.mLastRun) < task.mIntervalSeconds * 1000.0f) { continue; }
+
+		task.mCarryMillis = std::min(task.mCarryMillis + task.mSliceMillis, task.mSliceMillis * FRAME_TASK_MAX_CARRY_SLICES);
+		float remaining = frameTaskBudget - millisSince(runStart);
+
+		// still paying back an overrun, or out of frame time. high priority tasks always get at least a little, even while
+		// paying back, or a single long frame would stop them for several frames
+		float budget = std::min(task.mCarryMillis, std::max(0.0f, remaining));
+		if (task.mPriority == FrameTaskPriority::HIGH) { budget = std::max(budget, task.mSliceMillis * FRAME_TASK_MIN_HIGH_SLICE); }
+		else if (task.mSkipCount >= FRAME_TASK_MAX_SKIPS) { budget = std::max(budget, task.mSliceMillis); }
+		if (budget <= 0.0f)
+		{
+			task.mSkipCount++;
+			continue;
+		}
+
+		auto taskStart = std::chrono::steady_clock::now();
+		task.mTask(budget);
+		float taken = millisSince(taskStart);
+
+		task.mLastRun = std::chrono::steady_clock::now();
+		task.mCarryMillis -= taken;
+		task.mLastMillis = taken;
+		task.mAverageMillis += (taken - task.mAverageMillis) * 0.1f;
+		task.mSkipCount = 0;
+	}
+
+	frameTaskMillis += millisSince(runStart);
+}
+
+int FrameScheduler::getTaskCount() { return (int)frameTasks.size(); }
+
+const std::string& FrameScheduler::getTaskName(int task) { return frameTasks[task].mName; }
+
+float FrameScheduler::getTaskMillis(int task) { return frameTasks[task].mLastMillis; }
+
+float FrameScheduler::getTaskAverageMillis(int task) { return frameTasks[task].mAverageMillis; }
+
+float FrameScheduler::getTaskCarryMillis(int task) { return frameTasks[task].mCarryMillis; }
+
+int FrameScheduler::getTaskSkipCount(int task) { return frameTasks[task].mSkipCount; }
+
+float FrameScheduler::getFrameMillis() { return frameMillis; }
+
+float FrameScheduler::getTaskBudgetMillis() { return frameTaskBudget; }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+// high priority tasks run every frame, the others only while the frame has time left
+enum class FrameTaskPriority
+{
+	HIGH,
+	NORMAL,
+	LOW
+};
+
+// spreads main thread work over frames so the frame time stays near a target. every task gets a time slice per frame
+// it is run with. slices a task doesn't use carry over to the next frames (up to a few slices), going over its slice is
+// paid back by skipping frames. the time available to tasks is the target frame time minus what the rest of the frame
+// (drawing, ui, physics) took on average
+class FrameScheduler
+{
+private:
+	FrameScheduler() {}
+
+public:
+	// gets the milliseconds it may take this frame, work that doesn't fit should wait for the next call
+	typedef std::function<void(float budgetMillis)> Task;
+
+	// intervalSeconds > 0 runs the task at most that often, for periodic work like autosaving
+	static int addTask(const std::string& name, FrameTaskPriority priority, float sliceMillis, const Task& task, float intervalSeconds = 0.0f);
+
+	static void setTargetFrameMillis(float millis);
+	static float getTargetFrameMillis();
+
+	// call at the start of every frame, before run
+	static void beginFrame();
+	// runs the tasks that are due, in priority order
+	static void run();
+
+	// stats, timings are of the last frame the task ran unless stated otherwise
+	static int getTaskCount();
+	static const std::string& getTaskName(int task);
+	static float getTaskMillis(int task);
+	static float getTaskAverageMillis(int task); // smoothed over recent frames
+	static float getTaskCarryMillis(int task); // negative while paying back an overrun
+	static int getTaskSkipCount(int task); // frames skipped in a row
+	static float getFrameMillis(); // smoothed
+	static float getTaskBudgetMillis(); // time the tasks had during the last frame
+};
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include <cstdio>
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+
+#include "JobSystem.h"
+
+const int JOB_PRIORITY_COUNT = 3;
+
+struct JobWorker
+{
+	std::mutex mMutex;
+	std::deque<JobHandle> mQueues[JOB_PRIORITY_COUNT];
+	std::thread mThread;
+
+	std::atomic<long long> mBusyMicros;
+	std::atomic<int> mJobs;
+	std::atomic<int> mSteals;
+
+	// values of the last sample
+	float mUtilization = 0.0f;
+	int mSampleJobs = 0;
+	int mSampleSteals = 0;
+
+	JobWorker() : mBusyMicros(0), mJobs(0), mSteals(0) {}
+};
+
+std::vector<std::unique_ptr<JobWorker>> jobWorkers;
+std::atomic<int> queuedJobs(0);
+std::atomic<unsigned int> nextSubmitWorker(0);
+bool jobWorkersStopping = false;
+std::mutex jobSleepMutex;
+std::condition_variable jobSleepCondition;
+
+std::mutex mainThreadJobsMutex;
+std::vector<JobHandle> mainThreadJobs;
+
+std::chrono::steady_clock::time_point lastUtilizationSample = std::chrono::steady_clock::now();
+
+thread_local int currentJobWorker = -1;
+
+void finishJob(const JobHandle& job);
+
+void enqueueJob(const JobHandle& job)
+{
+	if (job->mMainThread)
+	{
+		std::lock_guard<std::mutex> lock(mainThreadJobsMutex);
+		mainThreadJobs.push_back(job);
+		return;
+	}
+
+	// without workers (not initialized or shut down) jobs just run on the caller
+	if (jobWorkers.empty())
+	{
+		job->mFunc();
+		finishJob(job);
+		return;
+	}
+
+	// workers keep the jobs they spawn, everything else is spread over all of them
+	int index = currentJobWorker >= 0 ? currentJobWorker : (int)(nextSubmitWorker++ % jobWorkers.size());
+	JobWorker* worker = jobWorkers[index].get();
+	{
+		std::lock_guard<std::mutex> lock(worker->mMutex);
+		worker->mQueues[(int)job->mPriority].push_back(job);
+	}
+	queuedJobs++;
+
+	// taking the lock makes sure a worker about to sleep sees the new job
+	{
+		std::lock_guard<std::mutex> lock(jobSleepMutex);
+	}
+	jobSleepCondition.notify_one();
+}
+
+void finishJob(const JobHandle& job)
+{
+	std::vector<JobHandle> continuations;
+	{
+		std::lock_guard<std::mutex> lock(job->mMutex);
+		job->mDone.store(true, std::memory_order_release);
+		continuations.swap(job->mContinuations);
+	}
+	for (auto& continuation : continuations) { enqueueJob(continuation); }
+}
+
+// own newest job first, then the oldest of another worker, highest priority first across all workers
+JobHandle takeJob(int index, bool& stolen)
+{
+	int count = (int)jobWorkers.size();
+	for (int priority = 0; priority < JOB_PRIORITY_COUNT; priority++)
+	{
+		if (index >= 0)
+		{
+			JobWorker* own = jobWorkers[index].get();
+			std::lock_guard<std::mutex> lock(own->mMutex);
+			std::deque<JobHandle>& queue = own->mQueues[priority];
+			if (!queue.empty())
+			{
+				JobHandle job = queue.back();
+				queue.pop_back();
+				queuedJobs--;
+				stolen = false;
+				return job;
+			}
+		}
+
+		for (int i = 1; i <= count; i++)
+		{
+			int victimIndex = (index + i + count) % count;
+			if (victimIndex == index) { continue; }
+
+			JobWorker* victim = jobWorkers[victimIndex].get();
+			std::lock_guard<std::mutex> lock(victim->mMutex);
+			std::deque<JobHandle>& queue = victim->mQueues[priority];
+			if (!queue.empty())
+			{
+				JobHandle job = queue.front();
+				queue.pop_front();
+				queuedJobs--;
+				stolen = true;
+				return job;
+			}
+		}
+	}
+	return JobHandle();
+}
+
+void jobWorkerProc(int index)
+{
+	currentJobWorker = index;
+	JobWorker* worker = jobWorkers[index].get();
+
+	while (true)
+	{
+		bool stolen = false;
+		JobHandle job = takeJob(index, stolen);
+		if (!job)
+		{
+			std::unique_lock<std::mutex> lock(jobSleepMutex);
+			jobSleepCondition.wait(lock, [] { return jobWorkersStopping || queuedJobs > 0; });
+			if (jobWorkersStopping && queuedJobs == 0) { return; }
+			continue;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		job->mFunc();
+		finishJob(job);
+		worker->mBusyMicros += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		worker->mJobs++;
+		if (stolen) { worker->mSteals++; }
+	}
+}
+
+void JobSystem::init(int threads)
+{
+	if (!jobWorkers.empty()) { return; }
+
+	if (threads <= 0) { threads = std::max(1, (int)std::thread::hardware_concurrency() - 1); }
+	jobWorkersStopping = false;
+	for (int i = 0; i < threads; i++) { jobWorkers.push_back(std::unique_ptr<JobWorker>(new JobWorker())); }
+	for (int i = 0; i < threads; i++) { jobWorkers[i]->mThread = std::thread(jobWorkerProc, i); }
+	printf("Started %d job workers\n", threads);
+}
+
+void JobSystem::shutdown()
+{
+	if (jobWorkers.empty()) { return; }
+
+	{
+		std::lock_guard<std::mutex> lock(jobSleepMutex);
+		jobWorkersStopping = true;
+	}
+	jobSleepCondition.notify_all();
+	for (auto& worker : jobWorkers) { worker->mThread.join(); }
+	jobWorkers.clear();
+}
+
+JobHandle JobSystem::submit(const std::function<void()>& func, JobPriority priority)
+{
+	JobHandle job(new Job(func, priority, false));
+	enqueueJob(job);
+	return job;
+}
+
+JobHandle addContinuation(const JobHandle& job, const JobHandle& continuation)
+{
+	{
+		std::lock_guard<std::mutex> lock(job->mMutex);
+		if (!job->isDone()) { job->mContinuations.push_back(continuation); return continuation; }
+	}
+	enqueueJob(continuation);
+	return continuation;
+}
+
+JobHandle JobSystem::then(const JobHandle& job, const std::function<void()>& func, JobPriority priority) { return addContinuation(job, JobHandle(new Job(func, priority, false))); }
+
+JobHandle JobSystem::thenOnMainThread(const JobHandle& job, const std::function<void()>& func) { return addContinuation(job, JobHandle(new Job(func, JobPriority::NORMAL, true))); }
+
+void JobSystem::wait(const JobHandle& job)
+{
+	while (!job->isDone())
+	{
+		bool stolen = false;
+		JobHandle other = takeJob(currentJobWorker, stolen);
+		if (!other) { std::this_thread::yield(); continue; }
+
+		other->mFunc();
+		finishJob(other);
+	}
+}
+
+void JobSystem::runMainThreadJobs(float budgetMillis)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<JobHandle> jobs;
+	{
+		std::lock_guard<std::mutex> lock(mainThreadJobsMutex);
+		jobs.swap(mainThreadJobs);
+	}
+
+	size_t i = 0;
+	for (; i < jobs.size() && (i == 0 || std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() < budgetMillis); i++)
+	{
+		jobs[i]->mFunc();
+		finishJob(jobs[i]);
+	}
+	if (i == jobs.size()) { return; }
+
+	// the rest go first next time, ahead of anything queued meanwhile
+	std::lock_guard<std::mutex> lock(mainThreadJobsMutex);
+	mainThreadJobs.insert(mainThreadJobs.begin(), jobs.begin() + i, jobs.end());
+}
+
+void JobSystem::sampleUtilization()
+{
+	auto now = std::chrono::steady_clock::now();
+	long long elapsedMicros = std::chrono::duration_cast<std::chrono::microseconds>(now - lastUtilizationSample).count();
+	lastUtilizationSample = now;
+	if (elapsedMicros <= 0) { return; }
+
+	for (auto& worker : jobWorkers)
+	{
+		worker->mUtilization = std::min(1.0f, (float)worker->mBusyMicros.exchange(0) / (float)elapsedMicros);
+		worker->mSampleJobs = worker->mJobs.exchange(0);
+		worker->mSampleSteals = worker->mSteals.exchange(0);
+	}
+}
+
+int JobSystem::getWorkerCount() { return (int)jobWorkers.size(); }
+
+float JobSystem::getWorkerUtilization(int worker) { return jobWorkers[worker]->mUtilization; }
+
+int JobSystem::getWorkerJobCount(int worker) { return jobWorkers[worker]->mSampleJobs; }
+
+int JobSystem::getWorkerStealCount(int worker) { return jobWorkers[worker]->mSampleSteals; }
+
+int JobSystem::getQueuedJobCount() { return queuedJobs; }
+
+// joins the workers at exit, before the thread objects they run on are destroyed
+struct JobSystemExitGuard
+{
+	~JobSystemExitGuard() { JobSystem::shutdown(); }
+} jobSystemExitGuard;
\ No newline at end of file
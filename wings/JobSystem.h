@@ -0,0 +1,67 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <limits>
+
+enum class JobPriority
+{
+	HIGH,
+	NORMAL,
+	LOW
+};
+
+// a submitted job. handles are shared between the submitter and the job system, so a job never outlives what it needs
+struct Job
+{
+	std::function<void()> mFunc;
+	JobPriority mPriority;
+	bool mMainThread;
+	std::atomic<bool> mDone;
+	std::mutex mMutex; // guards finishing against adding continuations
+	std::vector<std::shared_ptr<Job>> mContinuations;
+
+	Job(const std::function<void()>& func, JobPriority priority, bool mainThread) : mFunc(func), mPriority(priority), mMainThread(mainThread), mDone(false) {}
+
+	bool isDone() const { return mDone.load(std::memory_order_acquire); }
+};
+
+typedef std::shared_ptr<Job> JobHandle;
+
+// fixed pool of worker threads, one per hardware thread besides the main one. every worker has its own queue per
+// priority, runs its own newest job first and steals the oldest jobs of other workers when it runs out.
+// jobs meant for the main thread are queued until runMainThreadJobs is called
+class JobSystem
+{
+private:
+	JobSystem() {}
+
+public:
+	// threads <= 0 sizes the pool to hardware_concurrency - 1
+	static void init(int threads = 0);
+	// runs everything still queued, then joins the workers
+	static void shutdown();
+
+	static JobHandle submit(const std::function<void()>& func, JobPriority priority = JobPriority::NORMAL);
+
+	// continuations start once the job finished, right away if it already has
+	static JobHandle then(const JobHandle& job, const std::function<void()>& func, JobPriority priority = JobPriority::NORMAL);
+	static JobHandle thenOnMainThread(const JobHandle& job, const std::function<void()>& func);
+
+	// runs queued worker jobs on the calling thread until the job finished. not for main thread jobs
+	static void wait(const JobHandle& job);
+
+	// main thread, once a frame. jobs that don't fit in the budget (at least one runs) wait for the next call
+	static void runMainThreadJobs(float budgetMillis = std::numeric_limits<float>::max());
+
+	// busy time of each worker since the previous sample, call once a frame
+	static void sampleUtilization();
+	static int getWorkerCount();
+	static float getWorkerUtilization(int worker);
+	static int getWorkerJobCount(int worker); // jobs run during the last sample
+	static int getWorkerStealCount(int worker); // jobs taken from other workers during the last sample
+	static int getQueuedJobCount();
+};
\ No newline at end of file
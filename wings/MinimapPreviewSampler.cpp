@@ -0,0 +1,68 @@
+#include "MinimapPreviewSampler.h"
+
+MinimapPreviewSampler::MinimapPreviewSampler(const ColumnSampler& sampler, const TileSink& sink, int threads) : mSampler(sampler), mSink(sink)
+{
+	for (int i = 0; i < threads; i++) { mWorkers.push_back(std::thread(&MinimapPreviewSampler::workerProc, this)); }
+}
+
+MinimapPreviewSampler::~MinimapPreviewSampler()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mCondition.notify_all();
+	for (auto& worker : mWorkers) { worker.join(); }
+}
+
+void MinimapPreviewSampler::request(const glm::ivec3& tile)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (!mQueued.insert(tile).second) { return; }
+
+		// drop the oldest requests, they have most likely been panned out of view already
+		mRequests.push_back(tile);
+		if (mRequests.size() > MAX_PENDING)
+		{
+			mQueued.erase(mRequests.front());
+			mRequests.pop_front();
+		}
+	}
+	mCondition.notify_one();
+}
+
+void MinimapPreviewSampler::workerProc()
+{
+	unsigned char rgba[TILE_SIZE * TILE_SIZE * 4];
+
+	while (true)
+	{
+		glm::ivec3 tile;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this] { return mStopping || !mRequests.empty(); });
+			if (mStopping) { return; }
+			tile = mRequests.back();
+			mRequests.pop_back();
+		}
+
+		// one sample per texel, taken from the middle of the area the texel covers
+		int scale = 1 << tile.z;
+		int startX = tile.x * TILE_SIZE * scale + scale / 2;
+		int startZ = tile.y * TILE_SIZE * scale + scale / 2;
+		for (int z = 0; z < TILE_SIZE; z++)
+		{
+			for (int x = 0; x < TILE_SIZE; x++)
+			{
+				mSampler(startX + x * scale, startZ + z * scale, rgba + ((z * TILE_SIZE) + x) * 4);
+			}
+		}
+
+		mSink(tile, rgba);
+
+		// finished tiles may be requested again once real data shows up next to them
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQueued.erase(tile);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "VecUtil.h"
+
+// predicts world map tiles straight from the terrain functions on a few worker threads, without generating any chunks.
+// requests are served newest first since those are the tiles currently on screen
+class MinimapPreviewSampler
+{
+public:
+	static const int TILE_SIZE = 16;
+	static const int MAX_PENDING = 512;
+
+	// writes the predicted rgba color of the voxel column at (x, z), must be thread safe
+	typedef std::function<void(int x, int z, unsigned char* rgba)> ColumnSampler;
+	// receives each finished (tileX, tileZ, level) tile, called from the worker threads
+	typedef std::function<void(const glm::ivec3& tile, const unsigned char* rgba)> TileSink;
+
+private:
+	ColumnSampler mSampler;
+	TileSink mSink;
+
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::deque<glm::ivec3> mRequests;
+	std::unordered_set<glm::ivec3, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> mQueued;
+	bool mStopping = false;
+	std::vector<std::thread> mWorkers;
+
+	void workerProc();
+
+public:
+	MinimapPreviewSampler(const ColumnSampler& sampler, const TileSink& sink, int threads);
+	~MinimapPreviewSampler();
+
+	void request(const glm::ivec3& tile);
+};
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include <algorithm>
+
+#include "MinimapTileCache.h"
+
+#include "Renderer.h"
+
+int MinimapTileCache::allocateSlot()
+{
+	if (mTexture == 0)
+	{
+		mTexture = Renderer::createTexture(ATLAS_TILES * TILE_SIZE, ATLAS_TILES * TILE_SIZE);
+		mSlotOwners.resize(ATLAS_TILES * ATLAS_TILES);
+		for (int i = ATLAS_TILES * ATLAS_TILES - 1; i >= 0; i--) { mFreeSlots.push_back(i); }
+	}
+
+	if (!mFreeSlots.empty())
+	{
+		int slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+		return slot;
+	}
+
+	// atlas is full, steal the slot of the least recently drawn tile
+	int oldestSlot = -1;
+	unsigned int oldestFrame = mFrame;
+	for (int i = 0; i < (int)mSlotOwners.size(); i++)
+	{
+		auto owner = mTiles.find(mSlotOwners[i]);
+		if (owner != mTiles.end() && owner->second.lastUsedFrame < oldestFrame) { oldestFrame = owner->second.lastUsedFrame; oldestSlot = i; }
+	}
+	if (oldestSlot == -1) { return -1; }
+
+	mTiles.erase(mSlotOwners[oldestSlot]);
+	return oldestSlot;
+}
+
+void MinimapTileCache::uploadTile(const glm::ivec3& tile, TileEntry& entry)
+{
+	unsigned char rgba[TILE_SIZE * TILE_SIZE * 4];
+	entry.dirty = false;
+
+	if (!mSource(tile, rgba))
+	{
+		// nothing to show, give the slot back
+		if (entry.slot != -1) { mFreeSlots.push_back(entry.slot); entry.slot = -1; }
+		return;
+	}
+
+	if (entry.slot == -1)
+	{
+		entry.slot = allocateSlot();
+		if (entry.slot == -1) { entry.dirty = true; return; }
+		mSlotOwners[entry.slot] = tile;
+	}
+
+	Renderer::updateTexture(mTexture, (entry.slot % ATLAS_TILES) * TILE_SIZE, (entry.slot / ATLAS_TILES) * TILE_SIZE, TILE_SIZE, TILE_SIZE, rgba);
+}
+
+void MinimapTileCache::invalidate(const glm::ivec3& tile)
+{
+	auto it = mTiles.find(tile);
+	if (it != mTiles.end()) { it->second.dirty = true; }
+}
+
+void MinimapTileCache::draw(int level, const glm::ivec2& texelOffset, const glm::ivec2& screenPos, const glm::ivec2& size)
+{
+	mFrame++;
+
+	glm::ivec2 firstTile(floorDiv(texelOffset.x, TILE_SIZE), floorDiv(texelOffset.y, TILE_SIZE));
+	glm::ivec2 lastTile(floorDiv(texelOffset.x + size.x - 1, TILE_SIZE), floorDiv(texelOffset.y + size.y - 1, TILE_SIZE));
+	const float texelSize = 1.0f / (ATLAS_TILES * TILE_SIZE);
+
+	Renderer::color4f(1.0f, 1.0f, 1.0f, 1.0f);
+	for (int tx = firstTile.x; tx <= lastTile.x; tx++)
+	{
+		for (int tz = firstTile.y; tz <= lastTile.y; tz++)
+		{
+			glm::ivec3 tile(tx, tz, level);
+			auto it = mTiles.find(tile);
+			if (it == mTiles.end()) { it = mTiles.emplace(tile, TileEntry()).first; }
+			TileEntry& entry = it->second;
+			entry.lastUsedFrame = mFrame;
+			if (entry.dirty) { uploadTile(tile, entry); }
+			if (entry.slot == -1) { continue; }
+
+			// clip the tile against the displayed area
+			glm::ivec2 lower(std::max(tx * TILE_SIZE, texelOffset.x), std::max(tz * TILE_SIZE, texelOffset.y));
+			glm::ivec2 upper(std::min((tx + 1) * TILE_SIZE, texelOffset.x + size.x), std::min((tz + 1) * TILE_SIZE, texelOffset.y + size.y));
+
+			int slotX = (entry.slot % ATLAS_TILES) * TILE_SIZE - tx * TILE_SIZE;
+			int slotY = (entry.slot / ATLAS_TILES) * TILE_SIZE - tz * TILE_SIZE;
+			Renderer::drawTexturedQuad2D(mTexture, screenPos.x + lower.x - texelOffset.x, screenPos.y + lower.y - texelOffset.y, upper.x - lower.x, upper.y - lower.y,
+				(slotX + lower.x) * texelSize, (slotY + lower.y) * texelSize, (slotX + upper.x) * texelSize, (slotY + upper.y) * texelSize);
+		}
+	}
+
+	// tiles with nothing to show hold no slot, so eviction never drops them. forget the ones scrolled out of view once
+	// the cache holds more than twice as many tiles as the atlas has slots, more than half of them without one
+	if (mTiles.size() > 2 * ATLAS_TILES * ATLAS_TILES)
+	{
+		for (auto it = mTiles.begin(); it != mTiles.end();)
+		{
+			if (it->second.slot == -1 && it->second.lastUsedFrame != mFrame) { it = mTiles.erase(it); }
+			else { ++it; }
+		}
+	}
+}
\ No newline at end of file
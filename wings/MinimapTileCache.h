@@ -0,0 +1,49 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "VecUtil.h"
+
+// caches 16x16 rgba minimap tiles in a texture atlas so the world map can be drawn as a handful of textured quads.
+// tiles are keyed by (tileX, tileZ, level), see MinimapTilePyramid
+class MinimapTileCache
+{
+public:
+	static const int TILE_SIZE = 16;
+	static const int ATLAS_TILES = 128;
+
+	// fills TILE_SIZE * TILE_SIZE rgba texels (row major by z) for a tile, returns false when there is nothing to show
+	typedef std::function<bool(const glm::ivec3& tile, unsigned char* rgba)> TileSource;
+
+private:
+	struct TileEntry
+	{
+		int slot = -1;
+		bool dirty = true;
+		unsigned int lastUsedFrame = 0;
+	};
+
+	TileSource mSource;
+	unsigned int mTexture = 0;
+	unsigned int mFrame = 0;
+	std::unordered_map<glm::ivec3, TileEntry, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> mTiles;
+	std::vector<glm::ivec3> mSlotOwners;
+	std::vector<int> mFreeSlots;
+
+	int allocateSlot();
+	void uploadTile(const glm::ivec3& tile, TileEntry& entry);
+
+public:
+	MinimapTileCache(const TileSource& source) : mSource(source) {}
+
+	// marks a tile for re-upload the next time it is drawn
+	void invalidate(const glm::ivec3& tile);
+
+	// draws the texel area [texelOffset, texelOffset + size) of a level one pixel per texel with its top left at screenPos
+	void draw(int level, const glm::ivec2& texelOffset, const glm::ivec2& screenPos, const glm::ivec2& size);
+};
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "MinimapTilePyramid.h"
+
+const unsigned int TILE_FILE_MAGIC = 0x50544D57; // "WMTP"
+const unsigned int TILE_FILE_VERSION = 2;
+const unsigned int TILE_FILE_INITIAL_CAPACITY = 1024;
+
+MinimapTilePyramid::MinimapTilePyramid(const std::string& path, uint64_t seed) : mPath(path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE) { printf("Failed to open minimap tile file %s!\n", path.c_str()); return; }
+	mFileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size_t existingSize = (size_t)fileSize.QuadPart;
+#else
+	mFileDescriptor = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (mFileDescriptor == -1) { printf("Failed to open minimap tile file %s!\n", path.c_str()); return; }
+
+	struct stat st;
+	fstat(mFileDescriptor, &st);
+	size_t existingSize = (size_t)st.st_size;
+#endif
+
+	// a new or unreadable file, or one of another world, is started over
+	bool valid = existingSize >= sizeof(FileHeader);
+	if (valid)
+	{
+		if (!mapFile(existingSize)) { return; }
+		valid = header()->magic == TILE_FILE_MAGIC && header()->version == TILE_FILE_VERSION && sizeof(FileHeader) + (size_t)header()->capacity * sizeof(TileRecord) <= existingSize;
+		if (valid && header()->seed != seed)
+		{
+			printf("Minimap tiles in %s are of seed %llu, not %llu, starting over\n", path.c_str(), (unsigned long long)header()->seed, (unsigned long long)seed);
+			valid = false;
+		}
+		if (!valid) { unmapFile(); }
+	}
+	if (!valid)
+	{
+		if (!mapFile(sizeof(FileHeader) + TILE_FILE_INITIAL_CAPACITY * sizeof(TileRecord))) { return; }
+		header()->magic = TILE_FILE_MAGIC;
+		header()->version = TILE_FILE_VERSION;
+		header()->count = 0;
+		header()->capacity = TILE_FILE_INITIAL_CAPACITY;
+		header()->seed = seed;
+	}
+
+	for (unsigned int i = 0; i < header()->count; i++)
+	{
+		TileRecord* rec = record(i);
+		mIndex[glm::ivec3(rec->x, rec->z, rec->level)] = i;
+	}
+	printf("Loaded %d minimap tiles from %s\n", (int)mIndex.size(), path.c_str());
+
+	mBuilder = std::thread(&MinimapTilePyramid::builderProc, this);
+}
+
+MinimapTilePyramid::~MinimapTilePyramid()
+{
+	{
+		std::lock_guard<std::mutex> lock(mQueueMutex);
+		mStopping = true;
+	}
+	mQueueCondition.notify_all();
+	if (mBuilder.joinable()) { mBuilder.join(); }
+
+	unmapFile();
+#ifdef _WIN32
+	if (mFileHandle != 0) { CloseHandle((HANDLE)mFileHandle); }
+#else
+	if (mFileDescriptor != -1) { close(mFileDescriptor); }
+#endif
+}
+
+bool MinimapTilePyramid::mapFile(size_t size)
+{
+#ifdef _WIN32
+	LARGE_INTEGER mappingSize;
+	mappingSize.QuadPart = (LONGLONG)size;
+	mMappingHandle = CreateFileMappingA((HANDLE)mFileHandle, 0, PAGE_READWRITE, mappingSize.HighPart, mappingSize.LowPart, 0);
+	if (mMappingHandle == 0) { printf("Failed to map minimap tile file %s!\n", mPath.c_str()); return false; }
+	mMapped = (unsigned char*)MapViewOfFile((HANDLE)mMappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+#else
+	struct stat st;
+	fstat(mFileDescriptor, &st);
+	if ((size_t)st.st_size < size && ftruncate(mFileDescriptor, (off_t)size) != 0) { printf("Failed to resize minimap tile file %s!\n", mPath.c_str()); return false; }
+	void* mapped = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, mFileDescriptor, 0);
+	mMapped = mapped == MAP_FAILED ? 0 : (unsigned char*)mapped;
+#endif
+	if (mMapped == 0) { printf("Failed to map minimap tile file %s!\n", mPath.c_str()); return false; }
+
+	mMappedSize = size;
+	return true;
+}
+
+void MinimapTilePyramid::unmapFile()
+{
+	if (mMapped == 0) { return; }
+
+#ifdef _WIN32
+	UnmapViewOfFile(mMapped);
+	CloseHandle((HANDLE)mMappingHandle);
+	mMappingHandle = 0;
+#else
+	munmap(mMapped, mMappedSize);
+#endif
+	mMapped = 0;
+	mMappedSize = 0;
+}
+
+bool MinimapTilePyramid::grow()
+{
+	unsigned int capacity = header()->capacity * 2;
+	unmapFile();
+	if (!mapFile(sizeof(FileHeader) + (size_t)capacity * sizeof(TileRecord))) { return false; }
+	header()->capacity = capacity;
+	return true;
+}
+
+void MinimapTilePyramid::writeTile(const glm::ivec3& key, const unsigned char* rgba, unsigned int flags, bool fillEmptyOnly)
+{
+	std::lock_guard<std::mutex> lock(mStoreMutex);
+	if (mMapped == 0) { return; }
+
+	TileRecord* rec;
+	auto it = mIndex.find(key);
+	if (it != mIndex.end())
+	{
+		rec = record(it->second);
+		if (fillEmptyOnly)
+		{
+			for (int i = 0; i < TILE_BYTES; i += 4)
+			{
+				if (rec->rgba[i + 3] == 0) { memcpy(rec->rgba + i, rgba + i, 4); }
+			}
+			rec->flags |= flags;
+			return;
+		}
+	}
+	else
+	{
+		if (header()->count == header()->capacity && !grow()) { return; }
+
+		unsigned int index = header()->count++;
+		rec = record(index);
+		rec->level = key.z;
+		rec->x = key.x;
+		rec->z = key.y;
+		mIndex[key] = index;
+	}
+
+	rec->flags = flags;
+	memcpy(rec->rgba, rgba, TILE_BYTES);
+}
+
+bool MinimapTilePyramid::readTile(const glm::ivec3& key, unsigned char* rgba, unsigned int* flags)
+{
+	std::lock_guard<std::mutex> lock(mStoreMutex);
+	if (mMapped == 0) { return false; }
+
+	auto it = mIndex.find(key);
+	if (it == mIndex.end()) { return false; }
+
+	TileRecord* rec = record(it->second);
+	memcpy(rgba, rec->rgba, TILE_BYTES);
+	if (flags != 0) { *flags = rec->flags; }
+	return true;
+}
+
+void MinimapTilePyramid::downsample(const glm::ivec3& key)
+{
+	unsigned char result[TILE_BYTES];
+	unsigned char child[TILE_BYTES];
+	unsigned int flags = 0;
+	bool real = false;
+
+	// texels without any real data below them keep what was there, usually a prediction
+	if (!readTile(key, result, &flags)) { memset(result, 0, TILE_BYTES); }
+
+	const int half = TILE_SIZE / 2;
+	for (int cx = 0; cx < 2; cx++)
+	{
+		for (int cz = 0; cz < 2; cz++)
+		{
+			// predicted children are left to the parent's own prediction
+			unsigned int childFlags = 0;
+			if (!readTile(glm::ivec3(key.x * 2 + cx, key.y * 2 + cz, key.z - 1), child, &childFlags) || (childFlags & TILE_REAL) == 0) { continue; }
+			real = true;
+
+			// each child fills one quarter of the parent, averaging the visible texels of every 2x2 block
+			for (int x = 0; x < half; x++)
+			{
+				for (int z = 0; z < half; z++)
+				{
+					int r = 0, g = 0, b = 0, count = 0;
+					for (int i = 0; i < 4; i++)
+					{
+						const unsigned char* texel = child + (((z * 2 + i / 2) * TILE_SIZE) + (x * 2 + i % 2)) * 4;
+						if (texel[3] == 0) { continue; }
+						r += texel[0];
+						g += texel[1];
+						b += texel[2];
+						count++;
+					}
+					if (count == 0) { continue; }
+
+					unsigned char* out = result + (((cz * half + z) * TILE_SIZE) + (cx * half + x)) * 4;
+					out[0] = (unsigned char)(r / count);
+					out[1] = (unsigned char)(g / count);
+					out[2] = (unsigned char)(b / count);
+					out[3] = 255;
+				}
+			}
+		}
+	}
+
+	if (real) { writeTile(key, result, flags | TILE_REAL, false); }
+}
+
+void MinimapTilePyramid::builderProc()
+{
+	while (true)
+	{
+		std::unordered_map<glm::ivec2, std::vector<unsigned char>, KeyHash_GLMIVec2, KeyEqual_GLMIVec2> columns;
+		{
+			std::unique_lock<std::mutex> lock(mQueueMutex);
+			mQueueCondition.wait(lock, [this] { return mStopping || !mPendingColumns.empty(); });
+			if (mStopping) { return; }
+			columns.swap(mPendingColumns);
+			mBuilding = true;
+		}
+
+		// write all queued columns first so parents shared by several of them are only rebuilt once per level
+		std::vector<glm::ivec3> changed;
+		std::unordered_set<glm::ivec3, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> dirty;
+		for (auto& column : columns)
+		{
+			glm::ivec3 key(column.first.x, column.first.y, 0);
+			writeTile(key, &column.second[0], TILE_REAL, false);
+			changed.push_back(key);
+			dirty.insert(glm::ivec3(floorDiv(key.x, 2), floorDiv(key.y, 2), 1));
+		}
+
+		for (int level = 1; level <= MAX_LEVEL; level++)
+		{
+			std::unordered_set<glm::ivec3, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> parents;
+			for (auto& key : dirty)
+			{
+				downsample(key);
+				changed.push_back(key);
+				if (level < MAX_LEVEL) { parents.insert(glm::ivec3(floorDiv(key.x, 2), floorDiv(key.y, 2), level + 1)); }
+			}
+			dirty.swap(parents);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mQueueMutex);
+			mChangedTiles.insert(mChangedTiles.end(), changed.begin(), changed.end());
+			mBuilding = false;
+		}
+		mIdleCondition.notify_all();
+	}
+}
+
+void MinimapTilePyramid::submitColumn(const glm::ivec2& column, const unsigned char* rgba)
+{
+	{
+		std::lock_guard<std::mutex> lock(mQueueMutex);
+		mPendingColumns[column].assign(rgba, rgba + TILE_BYTES);
+	}
+	mQueueCondition.notify_one();
+}
+
+void MinimapTilePyramid::submitPredictedTile(const glm::ivec3& key, const unsigned char* rgba)
+{
+	writeTile(key, rgba, TILE_PREDICTED, true);
+
+	std::lock_guard<std::mutex> lock(mQueueMutex);
+	mChangedTiles.push_back(key);
+}
+
+bool MinimapTilePyramid::getTile(const glm::ivec3& key, unsigned char* rgba, unsigned int* flags) { return readTile(key, rgba, flags); }
+
+void MinimapTilePyramid::takeChangedTiles(std::vector<glm::ivec3>& out)
+{
+	std::lock_guard<std::mutex> lock(mQueueMutex);
+	out.swap(mChangedTiles);
+	mChangedTiles.clear();
+}
+
+void MinimapTilePyramid::finish()
+{
+	std::unique_lock<std::mutex> lock(mQueueMutex);
+	mIdleCondition.wait(lock, [this] { return mStopping || (mPendingColumns.empty() && !mBuilding); });
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "VecUtil.h"
+
+// quadtree of 16x16 rgba world map tiles. level 0 holds one texel per voxel column (one tile per chunk column),
+// every level above is a 2x downsample of the one below. tiles are built on a background thread and stored in a
+// memory mapped tile file so the explored map survives restarts. tile keys are (tileX, tileZ, level).
+class MinimapTilePyramid
+{
+public:
+	static const int TILE_SIZE = 16;
+	static const int TILE_BYTES = TILE_SIZE * TILE_SIZE * 4;
+	static const int MAX_LEVEL = 10;
+
+	// a real tile was built from generated chunks, a predicted one (or the predicted parts of one) from noise only
+	static const unsigned int TILE_REAL = 1;
+	static const unsigned int TILE_PREDICTED = 2;
+
+private:
+	struct TileRecord
+	{
+		int level;
+		int x;
+		int z;
+		unsigned int flags;
+		unsigned char rgba[TILE_BYTES];
+	};
+
+	struct FileHeader
+	{
+		unsigned int magic;
+		unsigned int version;
+		unsigned int count;
+		unsigned int capacity;
+		uint64_t seed; // of the world the tiles show
+	};
+
+	std::string mPath;
+	void* mFileHandle = 0;
+	void* mMappingHandle = 0;
+	int mFileDescriptor = -1;
+	unsigned char* mMapped = 0;
+	size_t mMappedSize = 0;
+
+	std::mutex mStoreMutex;
+	std::unordered_map<glm::ivec3, unsigned int, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> mIndex;
+
+	std::mutex mQueueMutex;
+	std::condition_variable mQueueCondition;
+	std::unordered_map<glm::ivec2, std::vector<unsigned char>, KeyHash_GLMIVec2, KeyEqual_GLMIVec2> mPendingColumns;
+	std::vector<glm::ivec3> mChangedTiles;
+	std::condition_variable mIdleCondition;
+	bool mBuilding = false;
+	bool mStopping = false;
+	std::thread mBuilder;
+
+	FileHeader* header() { return (FileHeader*)mMapped; }
+	TileRecord* record(unsigned int index) { return (TileRecord*)(mMapped + sizeof(FileHeader)) + index; }
+
+	bool mapFile(size_t size);
+	void unmapFile();
+	bool grow();
+	void writeTile(const glm::ivec3& key, const unsigned char* rgba, unsigned int flags, bool fillEmptyOnly);
+	bool readTile(const glm::ivec3& key, unsigned char* rgba, unsigned int* flags);
+	void downsample(const glm::ivec3& key);
+	void builderProc();
+
+public:
+	// tiles stored for another world seed are thrown away
+	MinimapTilePyramid(const std::string& path, uint64_t seed);
+	~MinimapTilePyramid();
+
+	// queues a copy of a level 0 tile, the pyramid above it is rebuilt in the background
+	void submitColumn(const glm::ivec2& column, const unsigned char* rgba);
+
+	// thread safe, merges a predicted tile into the texels no real data has reached yet
+	void submitPredictedTile(const glm::ivec3& key, const unsigned char* rgba);
+
+	// thread safe, returns false if the tile was never built
+	bool getTile(const glm::ivec3& key, unsigned char* rgba, unsigned int* flags = 0);
+
+	// tiles rebuilt since the last call, so cached textures can be refreshed
+	void takeChangedTiles(std::vector<glm::ivec3>& out);
+
+	// blocks until every submitted column and the tiles above it are built, queued columns are dropped when destroyed
+	void finish();
+};
\ No newline at end of file
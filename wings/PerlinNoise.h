@@ -2,10 +2,22 @@
 
 #include <cmath>
 
+// instruction sets the batch functions can use
+enum class NoiseKernel
+{
+	SCALAR,
+	SSE4,
+	AVX2
+};
+
 // Improved Perlin Noise. https://cs.nyu.edu/~perlin/noise/
 class PerlinNoise
 {
 public:
+	// batch results are computed in float and differ from noise() by at most this much, all kernels give the same
+	// results. see PerlinNoise.cpp
+	static constexpr float BATCH_EPSILON = 1.0e-5f;
+
 	PerlinNoise()
 	{
 		int permutation[] = { 151,160,137,91,90,15,
@@ -49,6 +61,20 @@ public:
 					grad(p[BB + 1], x - 1, y - 1, z - 1))));
 	}
 
+	// evaluates the noise at every point of the grid xs by ys by zs into out[(ix * ny + iy) * nz + iz], the same order
+	// as looping over x, then y, then z. the lattice cell of every coordinate is found in double precision, only the
+	// interpolation is done in float
+	void noiseGrid(const double* xs, int nx, const double* ys, int ny, const double* zs, int nz, float* out, NoiseKernel kernel) const;
+	void noiseGrid(const double* xs, int nx, const double* ys, int ny, const double* zs, int nz, float* out) const { noiseGrid(xs, nx, ys, ny, zs, nz, out, getBestKernel()); }
+
+	// a single row along z
+	void noiseRow(double x, double y, const double* zs, int count, float* out) const { noiseGrid(&x, 1, &y, 1, zs, count, out); }
+
+	// the fastest kernel the cpu supports
+	static NoiseKernel getBestKernel();
+	static bool isKernelSupported(NoiseKernel kernel);
+	static const char* getKernelName(NoiseKernel kernel);
+
 private:
 	static double fade(double t) { return t * t * t * (t * (t * 6 - 15) + 10); }
 	static double lerp(double t, double a, double b) { return a + t * (b - a); }
@@ -0,0 +1,26 @@
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#include "ProcessMemory.h"
+
+size_t ProcessMemory::getPeakBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) { return 0; }
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+#ifdef __APPLE__
+	return (size_t)usage.ru_maxrss; // bytes
+#else
+	return (size_t)usage.ru_maxrss * 1024; // kilobytes
+#endif
+#endif
+}
\ No newline at end of file
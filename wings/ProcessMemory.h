@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+// memory use of this process as the os sees it, for the command line tools
+class ProcessMemory
+{
+private:
+	ProcessMemory() {}
+
+public:
+	static size_t getPeakBytes(); // highest resident size so far, 0 if unknown
+};
\ No newline at end of file
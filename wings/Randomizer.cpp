@@ -1,11 +1,71 @@
 #include "Randomizer.h"
 
 #include <random>
+#include <climits>
 
-std::random_device rd;
-std::mt19937 mt(rd());
+// each thread gets its own engine so background workers can roll numbers too
+thread_local std::mt19937 mt(std::random_device{}());
+// the innermost seeded scope of this thread
+thread_local RandomStream* seededStream = 0;
 
-int Randomizer::getRandomInt() { return std::uniform_int_distribution<int>()(mt); }
-int Randomizer::getRandomInt(int min, int max) { return std::uniform_int_distribution<int>(min, max)(mt); }
-double Randomizer::getRandomDouble() { return std::uniform_real_distribution<double>()(mt); }
-float Randomizer::getRandomFloat() { return std::uniform_real_distribution<float>()(mt); }
\ No newline at end of file
+uint64_t worldSeed = ((uint64_t)std::random_device{}() << 32) | std::random_device{}();
+
+const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+
+uint64_t mix64(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+uint64_t RandomStream::next() { return mix64(mKey + (++mCounter) * GOLDEN_GAMMA); }
+
+int RandomStream::nextInt(int min, int max)
+{
+	// multiply instead of modulo, the bias for ranges this small is far below anything visible
+	uint64_t range = (uint64_t)((int64_t)max - (int64_t)min + 1);
+	return (int)((int64_t)min + (int64_t)(((next() >> 32) * range) >> 32));
+}
+
+double RandomStream::nextDouble() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+float RandomStream::nextFloat() { return (next() >> 40) * (1.0f / 16777216.0f); }
+
+int Randomizer::getRandomInt()
+{
+	if (seededStream) { return seededStream->nextInt(0, INT_MAX); }
+	return std::uniform_int_distribution<int>()(mt);
+}
+
+int Randomizer::getRandomInt(int min, int max)
+{
+	if (seededStream) { return seededStream->nextInt(min, max); }
+	return std::uniform_int_distribution<int>(min, max)(mt);
+}
+
+double Randomizer::getRandomDouble()
+{
+	if (seededStream) { return seededStream->nextDouble(); }
+	return std::uniform_real_distribution<double>()(mt);
+}
+
+float Randomizer::getRandomFloat()
+{
+	if (seededStream) { return seededStream->nextFloat(); }
+	return std::uniform_real_distribution<float>()(mt);
+}
+
+void Randomizer::setWorldSeed(uint64_t seed) { worldSeed = seed; }
+uint64_t Randomizer::getWorldSeed() { return worldSeed; }
+
+uint64_t Randomizer::getStreamKey(RandomPurpose purpose, int x, int y, int z) { return getStreamKey(mix64(worldSeed + ((uint64_t)purpose + 1) * GOLDEN_GAMMA), x, y, z); }
+
+uint64_t Randomizer::getStreamKey(uint64_t parent, int x, int y, int z)
+{
+	uint64_t key = mix64(parent ^ (uint32_t)x);
+	key = mix64(key ^ ((uint64_t)(uint32_t)y << 32));
+	return mix64(key ^ (uint32_t)z ^ ((uint64_t)(uint32_t)z << 32));
+}
+
+Randomizer::SeededScope::SeededScope(uint64_t key) : mStream(key), mPrevious(seededStream) { seededStream = &mStream; }
+Randomizer::SeededScope::~SeededScope() { seededStream = mPrevious; }
\ No newline at end of file
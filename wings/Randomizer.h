@@ -1,5 +1,36 @@
 #pragma once
 
+#include <cstdint>
+
+// what a seeded stream is used for, streams of different purposes at the same position are unrelated
+enum class RandomPurpose
+{
+	TERRAIN, // voxel colors of a chunk
+	BIOME, // biome of a biome region
+	TREE_PLACEMENT, // where in a chunk its tree grows
+	TREE, // which tree stamp grows, by trunk position
+	TOWN, // a town's dungeon theme, by town position
+	DUNGEON, // maze and spawn points, by dungeon position
+	DUNGEON_CHUNK, // piece variants and trees of a dungeon chunk
+	STRUCTURE_TEMPLATE // shape and colors of a structure stamp, by template and variant
+};
+
+// counter based generator (splitmix64), the n-th number only depends on the key and n, so streams need no shared state
+class RandomStream
+{
+private:
+	uint64_t mKey;
+	uint64_t mCounter = 0;
+
+public:
+	RandomStream(uint64_t key) : mKey(key) {}
+
+	uint64_t next();
+	int nextInt(int min, int max); // inclusive
+	double nextDouble(); // [0, 1)
+	float nextFloat(); // [0, 1)
+};
+
 class Randomizer
 {
 private:
@@ -10,4 +41,29 @@ public:
 	static int getRandomInt(int min, int max);
 	static double getRandomDouble();
 	static float getRandomFloat();
+
+	// every seeded stream derives from the world seed, set it before anything is generated
+	static void setWorldSeed(uint64_t seed);
+	static uint64_t getWorldSeed();
+
+	static uint64_t getStreamKey(RandomPurpose purpose, int x, int y, int z);
+	// a stream key derived from another one, for streams nested inside of something already seeded
+	static uint64_t getStreamKey(uint64_t parent, int x, int y, int z);
+
+	// while one exists, the calling thread's getRandom* calls draw from its stream instead of the unseeded engine, so
+	// generation code gives the same results on any thread and in any order. scopes nest, the innermost one is used
+	class SeededScope
+	{
+	private:
+		RandomStream mStream;
+		RandomStream* mPrevious;
+
+	public:
+		SeededScope(uint64_t key);
+		SeededScope(RandomPurpose purpose, int x, int y, int z) : SeededScope(getStreamKey(purpose, x, y, z)) {}
+		~SeededScope();
+
+		SeededScope(const SeededScope&) = delete;
+		SeededScope& operator = (const SeededScope&) = delete;
+	};
 };
\ No newline at end of file
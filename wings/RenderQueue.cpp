@@ -0,0 +1,172 @@
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include <glm/geometric.hpp>
+
+#include "RenderQueue.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+
+struct RenderItem
+{
+	unsigned long long key;
+	RenderPass pass;
+	RenderMaterial material;
+	std::function<void()> draw;
+};
+
+struct MaterialState
+{
+	std::function<void()> begin;
+	std::function<void()> end;
+};
+
+std::vector<RenderItem> renderItems;
+MaterialState materialStates[(int)RenderMaterial::REGION_BORDER + 1];
+std::vector<size_t> renderOrder;
+glm::vec3 renderCameraPos;
+
+int lastItemCount = 0;
+int lastStateChanges = 0;
+float lastOverdraw = 0.0f;
+
+// samples passed queries, read back a frame late so the cpu never waits on them
+GLuint overdrawQueries[2] = { 0, 0 };
+int overdrawQueryFrame = 0;
+
+unsigned int depthBits(float depth)
+{
+	// the bits of a positive float sort the same way as its value
+	unsigned int bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits;
+}
+
+void RenderQueue::setMaterialState(RenderMaterial material, const std::function<void()>& begin, const std::function<void()>& end)
+{
+	materialStates[(int)material].begin = begin;
+	materialStates[(int)material].end = end;
+}
+
+void RenderQueue::beginFrame(const glm::vec3& cameraPos)
+{
+	renderCameraPos = cameraPos;
+	renderItems.clear();
+}
+
+void RenderQueue::submit(RenderPass pass, RenderMaterial material, const glm::vec3& center, const std::function<void()>& draw)
+{
+	unsigned long long depth = depthBits(glm::distance(renderCameraPos, center));
+	unsigned long long key = (unsigned long long)pass << 63;
+
+	// solid: material, then near to far. translucent: far to near, then material
+	if (pass == RenderPass::SOLID) { key |= ((unsigned long long)material << 48) | depth; }
+	else { key |= ((~depth & 0xFFFFFFFFULL) << 16) | (unsigned long long)material; }
+
+	RenderItem item;
+	item.key = key;
+	item.pass = pass;
+	item.material = material;
+	item.draw = draw;
+	renderItems.push_back(item);
+}
+
+void beginPass(RenderPass pass)
+{
+	if (pass == RenderPass::SOLID)
+	{
+		glDisable(GL_BLEND);
+		glDepthMask(GL_TRUE);
+	}
+	else
+	{
+		glEnable(GL_BLEND);
+		glDepthMask(GL_FALSE);
+	}
+}
+
+void RenderQueue::execute()
+{
+	renderOrder.resize(renderItems.size());
+	for (size_t i = 0; i < renderOrder.size(); i++) { renderOrder[i] = i; }
+	std::stable_sort(renderOrder.begin(), renderOrder.end(), [](size_t a, size_t b) { return renderItems[a].key < renderItems[b].key; });
+
+	bool queries = GLEW_VERSION_1_5 != 0;
+	if (queries)
+	{
+		if (overdrawQueries[0] == 0) { glGenQueries(2, overdrawQueries); }
+
+		// collect the result of the query issued last frame
+		GLuint previous = overdrawQueries[(overdrawQueryFrame + 1) % 2];
+		GLint available = 0;
+		if (overdrawQueryFrame > 0) { glGetQueryObjectiv(previous, GL_QUERY_RESULT_AVAILABLE, &available); }
+		if (available)
+		{
+			GLuint samples = 0;
+			glGetQueryObjectuiv(previous, GL_QUERY_RESULT, &samples);
+			GLint viewport[4];
+			glGetIntegerv(GL_VIEWPORT, viewport);
+			lastOverdraw = (float)samples / (float)std::max(1, viewport[2] * viewport[3]);
+		}
+		glBeginQuery(GL_SAMPLES_PASSED, overdrawQueries[overdrawQueryFrame % 2]);
+	}
+
+	int stateChanges = 0;
+	bool first = true;
+	RenderPass pass = RenderPass::SOLID;
+	RenderMaterial material = RenderMaterial::VOXEL_MESH;
+	for (size_t index : renderOrder)
+	{
+		RenderItem& item = renderItems[index];
+		bool passChanged = first || item.pass != pass;
+		bool materialChanged = passChanged || item.material != material;
+
+		if (materialChanged && !first && materialStates[(int)material].end) { materialStates[(int)material].end(); }
+		if (passChanged)
+		{
+			// batched icons belong to the pass they were queued in
+			if (!first) { Renderer::flush(); }
+			beginPass(item.pass);
+			pass = item.pass;
+			stateChanges++;
+		}
+		if (materialChanged)
+		{
+			material = item.material;
+			if (materialStates[(int)material].begin) { materialStates[(int)material].begin(); }
+			stateChanges++;
+		}
+		first = false;
+
+		item.draw();
+	}
+	if (!first && materialStates[(int)material].end) { materialStates[(int)material].end(); }
+	Renderer::flush();
+
+	if (queries)
+	{
+		glEndQuery(GL_SAMPLES_PASSED);
+		overdrawQueryFrame++;
+	}
+
+	// back to the defaults everything else expects
+	glEnable(GL_BLEND);
+	glDepthMask(GL_TRUE);
+
+	lastItemCount = (int)renderItems.size();
+	lastStateChanges = stateChanges;
+	renderItems.clear();
+}
+
+int RenderQueue::getItemCount() { return lastItemCount; }
+
+int RenderQueue::getStateChangeCount() { return lastStateChanges; }
+
+float RenderQueue::getOverdraw() { return lastOverdraw; }
\ No newline at end of file
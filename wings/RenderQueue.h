@@ -0,0 +1,42 @@
+#pragma once
+
+#include <functional>
+
+#include <glm/vec3.hpp>
+
+// passes are drawn in order, solid geometry front to back and translucent geometry back to front
+enum class RenderPass
+{
+	SOLID,
+	TRANSLUCENT
+};
+
+// items sharing a material are drawn together in the solid pass to cut down on state changes
+enum class RenderMaterial
+{
+	VOXEL_MESH,
+	SOLID_SHAPE,
+	WIREFRAME,
+	ICON,
+	LINES,
+	REGION_BORDER
+};
+
+class RenderQueue
+{
+private:
+	RenderQueue() {}
+
+public:
+	// state set up before and torn down after a run of items sharing a material
+	static void setMaterialState(RenderMaterial material, const std::function<void()>& begin, const std::function<void()>& end);
+
+	static void beginFrame(const glm::vec3& cameraPos);
+	static void submit(RenderPass pass, RenderMaterial material, const glm::vec3& center, const std::function<void()>& draw);
+	static void execute();
+
+	// stats of the last executed frame
+	static int getItemCount();
+	static int getStateChangeCount();
+	static float getOverdraw();
+};
\ No newline at end of file
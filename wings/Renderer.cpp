@@ -1,36 +1,214 @@
+#include <vector>
+#include <cstdio>
+
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
 #include "Renderer.h"
 
+#include <GL/glew.h>
 #ifdef __APPLE__
 #include <GLUT/glut.h>
 #else
 #include <GL/glut.h>
 #endif
 
-void Renderer::color3b(unsigned char r, unsigned char g, unsigned char b) { glColor3f(BYTE_TO_FLOAT_COLOR(r), BYTE_TO_FLOAT_COLOR(g), BYTE_TO_FLOAT_COLOR(b)); }
+void Renderer::init()
+{
+	GLenum err = glewInit();
+	if (err != GLEW_OK) { printf("Failed to load GL extensions: %s\n", glewGetErrorString(err)); return; }
+	printf("GL %s (%s)\n", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+}
+
+// the current color and modelview matrix, mirrored here so queuing a quad doesn't have to read them back from gl
+float currentColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+std::vector<glm::mat4> modelviewStack(1, glm::mat4(1.0f));
+
+void Renderer::color3b(unsigned char r, unsigned char g, unsigned char b) { color3f(BYTE_TO_FLOAT_COLOR(r), BYTE_TO_FLOAT_COLOR(g), BYTE_TO_FLOAT_COLOR(b)); }
+
+struct BatchVertex
+{
+	float x, y, z;
+	float r, g, b, a;
+	float u, v;
+};
+
+std::vector<BatchVertex> quadBatch;
+unsigned int quadBatchTexture = 0;
+int quadBatchQuads = 0;
+int quadBatchFlushes = 0;
+int lastFrameQuads = 0;
+int lastFrameFlushes = 0;
+
+void appendQuad(int x, int y, int width, int height, float u0, float v0, float u1, float v1)
+{
+	const glm::mat4& mv = modelviewStack.back();
+
+	const float cornersX[4] = { (float)x, (float)x, (float)(x + width), (float)(x + width) };
+	const float cornersY[4] = { (float)y, (float)(y + height), (float)(y + height), (float)y };
+	const float cornersU[4] = { u0, u0, u1, u1 };
+	const float cornersV[4] = { v0, v1, v1, v0 };
+	for (int i = 0; i < 4; i++)
+	{
+		BatchVertex v;
+		v.x = mv[0][0] * cornersX[i] + mv[1][0] * cornersY[i] + mv[3][0];
+		v.y = mv[0][1] * cornersX[i] + mv[1][1] * cornersY[i] + mv[3][1];
+		v.z = mv[0][2] * cornersX[i] + mv[1][2] * cornersY[i] + mv[3][2];
+		v.r = currentColor[0];
+		v.g = currentColor[1];
+		v.b = currentColor[2];
+		v.a = currentColor[3];
+		v.u = cornersU[i];
+		v.v = cornersV[i];
+		quadBatch.push_back(v);
+	}
+	quadBatchQuads++;
+}
 
 void Renderer::drawQuad2D(int x, int y, int width, int height)
 {
-	glBegin(GL_QUADS);
-	glVertex2i(x, y);
-	glVertex2i(x, y + height);
-	glVertex2i(x + width, y + height);
-	glVertex2i(x + width, y);
-	glEnd();
+	if (quadBatchTexture != 0) { flush(); quadBatchTexture = 0; }
+	appendQuad(x, y, width, height, 0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+void Renderer::drawTexturedQuad2D(unsigned int texture, int x, int y, int width, int height, float u0, float v0, float u1, float v1)
+{
+	if (quadBatchTexture != texture) { flush(); quadBatchTexture = texture; }
+	appendQuad(x, y, width, height, u0, v0, u1, v1);
+}
+
+void Renderer::flush()
+{
+	if (quadBatch.empty()) { return; }
+
+	glPushMatrix();
+	glLoadIdentity();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(BatchVertex), &quadBatch[0].x);
+	glColorPointer(4, GL_FLOAT, sizeof(BatchVertex), &quadBatch[0].r);
+	if (quadBatchTexture != 0)
+	{
+		glEnable(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, quadBatchTexture);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(2, GL_FLOAT, sizeof(BatchVertex), &quadBatch[0].u);
+	}
+	glDrawArrays(GL_QUADS, 0, (GLsizei)quadBatch.size());
+	if (quadBatchTexture != 0)
+	{
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glDisable(GL_TEXTURE_2D);
+	}
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glPopMatrix();
+
+	// the color array leaves the current color undefined, so set it again for the caller
+	glColor4fv(currentColor);
+	quadBatch.clear();
+	quadBatchFlushes++;
+}
+
+void Renderer::endFrame()
+{
+	flush();
+	lastFrameQuads = quadBatchQuads;
+	lastFrameFlushes = quadBatchFlushes;
+	quadBatchQuads = 0;
+	quadBatchFlushes = 0;
 }
 
+int Renderer::getFrameQuadCount() { return lastFrameQuads; }
+
+int Renderer::getFrameFlushCount() { return lastFrameFlushes; }
+
 void Renderer::clearColor(unsigned char r, unsigned char g, unsigned char b, unsigned char a) { glClearColor(BYTE_TO_FLOAT_COLOR(r), BYTE_TO_FLOAT_COLOR(g), BYTE_TO_FLOAT_COLOR(b), BYTE_TO_FLOAT_COLOR(a)); }
 
-void Renderer::color3f(float r, float g, float b) { glColor3f(r, g, b); }
+void Renderer::color3f(float r, float g, float b) { color4f(r, g, b, 1.0f); }
+
+void Renderer::color4f(float r, float g, float b, float a)
+{
+	currentColor[0] = r;
+	currentColor[1] = g;
+	currentColor[2] = b;
+	currentColor[3] = a;
+	glColor4f(r, g, b, a);
+}
+
+void Renderer::pushMatrix()
+{
+	modelviewStack.push_back(modelviewStack.back());
+	glPushMatrix();
+}
+
+void Renderer::translatef(float x, float y, float z)
+{
+	modelviewStack.back() = glm::translate(modelviewStack.back(), glm::vec3(x, y, z));
+	glTranslatef(x, y, z);
+}
+
+void Renderer::scalef(float x, float y, float z)
+{
+	modelviewStack.back() = glm::scale(modelviewStack.back(), glm::vec3(x, y, z));
+	glScalef(x, y, z);
+}
+
+void Renderer::rotatef(float degrees, float x, float y, float z)
+{
+	modelviewStack.back() = glm::rotate(modelviewStack.back(), glm::radians(degrees), glm::vec3(x, y, z));
+	glRotatef(degrees, x, y, z);
+}
+
+void Renderer::loadIdentity()
+{
+	modelviewStack.back() = glm::mat4(1.0f);
+	glLoadIdentity();
+}
 
-void Renderer::color4f(float r, float g, float b, float a) { glColor4f(r, g, b, a); }
+void Renderer::lookAt(float eyeX, float eyeY, float eyeZ, float centerX, float centerY, float centerZ, float upX, float upY, float upZ)
+{
+	modelviewStack.back() *= glm::lookAt(glm::vec3(eyeX, eyeY, eyeZ), glm::vec3(centerX, centerY, centerZ), glm::vec3(upX, upY, upZ));
+	gluLookAt(eyeX, eyeY, eyeZ, centerX, centerY, centerZ, upX, upY, upZ);
+}
 
-void Renderer::pushMatrix() { glPushMatrix(); }
+void Renderer::wireCube(double size) { flush(); glutWireCube(size); }
 
-void Renderer::translatef(float x, float y, float z) { glTranslatef(x, y, z); }
+void Renderer::solidCube(double size) { flush(); glutSolidCube(size); }
 
-void Renderer::wireCube(double size) { glutWireCube(size); }
+void Renderer::popMatrix()
+{
+	if (modelviewStack.size() > 1) { modelviewStack.pop_back(); }
+	glPopMatrix();
+}
+
+unsigned int Renderer::createTexture(int width, int height)
+{
+	std::vector<unsigned char> blank(width * height * 4, 0);
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &blank[0]);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return texture;
+}
+
+void Renderer::updateTexture(unsigned int texture, int x, int y, int width, int height, const unsigned char* rgba)
+{
+	// pending quads may still sample the old contents
+	if (texture == quadBatchTexture) { flush(); }
 
-void Renderer::popMatrix() { glPopMatrix(); }
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
 
 void* renderFonts[] = {
 	GLUT_BITMAP_8_BY_13,
@@ -60,7 +238,7 @@ void renderSpacedBitmapString(float x, float y, int spacing, void* font, const c
 	glPopMatrix();
 }
 
-void Renderer::renderString(int x, int y, RenderFont font, const std::string& str) { renderSpacedBitmapString((float)x, (float)y, 0, renderFonts[(int)font], str.c_str()); }
+void Renderer::renderString(int x, int y, RenderFont font, const std::string& str) { flush(); renderSpacedBitmapString((float)x, (float)y, 0, renderFonts[(int)font], str.c_str()); }
 
 int getSpacedStringWidth(int spacing, void* font, const char* string)
 {
@@ -22,15 +22,36 @@ public:
 	template<typename T>
 	static constexpr auto BYTE_TO_FLOAT_COLOR(T b) { return b / 255.0f; }
 
+	// loads gl extensions, must be called once the window is created
+	static void init();
+
 	static void color3b(unsigned char r, unsigned char g, unsigned char b);
+
+	// 2d quads are batched into a cpu vertex stream (pre-transformed by the current modelview matrix and
+	// tagged with the current color) and only drawn when the batch is flushed. flush() must be called before
+	// the projection matrix changes, and is called internally before anything that draws outside the batch.
+	// the color and modelview matrix are tracked by the renderer, so they must only be changed through it
 	static void drawQuad2D(int x, int y, int width, int height);
+	static void drawTexturedQuad2D(unsigned int texture, int x, int y, int width, int height, float u0, float v0, float u1, float v1);
+	static void flush();
+	static void endFrame();
+	static int getFrameQuadCount();
+	static int getFrameFlushCount();
+
 	static void clearColor(unsigned char r, unsigned char g, unsigned char b, unsigned char a);
 	static void color3f(float r, float g, float b);
 	static void color4f(float r, float g, float b, float a);
 	static void pushMatrix();
 	static void translatef(float x, float y, float z);
+	static void scalef(float x, float y, float z);
+	static void rotatef(float degrees, float x, float y, float z);
+	static void loadIdentity();
+	static void lookAt(float eyeX, float eyeY, float eyeZ, float centerX, float centerY, float centerZ, float upX, float upY, float upZ);
 	static void wireCube(double size);
+	static void solidCube(double size);
 	static void popMatrix();
+	static unsigned int createTexture(int width, int height);
+	static void updateTexture(unsigned int texture, int x, int y, int width, int height, const unsigned char* rgba);
 	static void renderString(int x, int y, RenderFont font, const std::string& str);
 	static int getStringWidth(RenderFont font, const std::string& string);
 };
\ No newline at end of file
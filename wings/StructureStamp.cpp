@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <atomic>
+#include <tuple>
+
+#include <glm/common.hpp>
+
+#include "StructureStamp.h"
+
+std::atomic<unsigned int> stampBuildCount(0);
+
+StructureStamp::StructureStamp(const glm::ivec3& lower, const glm::ivec3& size, const std::vector<StampVoxel>& voxels) : mLower(0), mUpper(-1), mBuildOrder(stampBuildCount++)
+{
+	bool empty = true;
+	for (int z = 0; z < size.z; z++)
+	{
+		for (int y = 0; y < size.y; y++)
+		{
+			const StampVoxel* row = &voxels[(size_t)(y + z * size.y) * size.x];
+			for (int x = 0; x < size.x; x++)
+			{
+				if (row[x].a == 0) { continue; }
+
+				// extend the run the voxel before started
+				if (x > 0 && row[x - 1].a != 0) { mSpans.back().mLength++; }
+				else
+				{
+					StampSpan span;
+					span.mStart = lower + glm::ivec3(x, y, z);
+					span.mLength = 1;
+					span.mOffset = (int)mVoxels.size();
+					mSpans.push_back(span);
+				}
+				mVoxels.push_back(row[x]);
+
+				glm::ivec3 pos(lower + glm::ivec3(x, y, z));
+				if (empty) { mLower = mUpper = pos; empty = false; }
+				else
+				{
+					mLower = glm::min(mLower, pos);
+					mUpper = glm::max(mUpper, pos);
+				}
+			}
+		}
+	}
+}
+
+void StructureStamp::forEachSpan(const glm::ivec3& origin, const glm::ivec3& lower, const glm::ivec3& upper, const SpanCopy& copy) const
+{
+	// relative to the origin from here on
+	glm::ivec3 low(lower - origin);
+	glm::ivec3 high(upper - origin);
+	if (mLower.x > high.x || mLower.y > high.y || mLower.z > high.z || mUpper.x < low.x || mUpper.y < low.y || mUpper.z < low.z) { return; }
+
+	for (auto& span : mSpans)
+	{
+		if (span.mStart.y < low.y || span.mStart.y > high.y || span.mStart.z < low.z || span.mStart.z > high.z) { continue; }
+
+		int start = std::max(span.mStart.x, low.x);
+		int end = std::min(span.mStart.x + span.mLength - 1, high.x);
+		if (start > end) { continue; }
+
+		copy(glm::ivec3(origin.x + start, origin.y + span.mStart.y, origin.z + span.mStart.z), &mVoxels[span.mOffset + start - span.mStart.x], end - start + 1);
+	}
+}
+
+bool StructurePlacement::operator<(const StructurePlacement& other) const
+{
+	return std::make_tuple(mOrigin.x, mOrigin.y, mOrigin.z, mStamp->getBuildOrder()) < std::make_tuple(other.mOrigin.x, other.mOrigin.y, other.mOrigin.z, other.mStamp->getBuildOrder());
+}
+
+void forEachUncoveredSpan(const StructurePlacement& placement, const std::vector<StructurePlacement>& placed, const glm::ivec3& lower, const glm::ivec3& upper, const StructureStamp::SpanCopy& copy)
+{
+	std::vector<const StructurePlacement*> later;
+	for (auto& other : placed) { if (placement < other) { later.push_back(&other); } }
+	if (later.empty())
+	{
+		placement.mStamp->forEachSpan(placement.mOrigin, lower, upper, copy);
+		return;
+	}
+
+	// the voxels of the structures after it
+	glm::ivec3 size(upper - lower + 1);
+	std::vector<bool> covered((size_t)size.x * size.y * size.z, false);
+	auto index = [&lower, &size](int x, int y, int z) { return (size_t)(x - lower.x) + ((size_t)(y - lower.y) + (size_t)(z - lower.z) * size.y) * size.x; };
+	for (const StructurePlacement* other : later)
+	{
+		other->mStamp->forEachSpan(other->mOrigin, lower, upper, [&covered, &index](const glm::ivec3& start, const StampVoxel* voxels, int count)
+		{
+			for (int i = 0; i < count; i++) { covered[index(start.x + i, start.y, start.z)] = true; }
+		});
+	}
+
+	// split every run around them
+	placement.mStamp->forEachSpan(placement.mOrigin, lower, upper, [&covered, &index, &copy](const glm::ivec3& start, const StampVoxel* voxels, int count)
+	{
+		int i = 0;
+		while (i < count)
+		{
+			while (i < count && covered[index(start.x + i, start.y, start.z)]) { i++; }
+			int first = i;
+			while (i < count && !covered[index(start.x + i, start.y, start.z)]) { i++; }
+			if (i > first) { copy(glm::ivec3(start.x + first, start.y, start.z), voxels + first, i - first); }
+		}
+	});
+}
+
+void StructurePlacementTable::getChunks(const StructurePlacement& placement, std::vector<glm::ivec3>& chunks)
+{
+	glm::ivec3 lower(placement.mOrigin + placement.mStamp->getLower());
+	glm::ivec3 upper(placement.mOrigin + placement.mStamp->getUpper());
+	if (upper.x < lower.x) { return; } // nothing solid
+
+	for (int x = floorDiv(lower.x, 16); x <= floorDiv(upper.x, 16); x++)
+	{
+		for (int y = floorDiv(lower.y, 16); y <= floorDiv(upper.y, 16); y++)
+		{
+			for (int z = floorDiv(lower.z, 16); z <= floorDiv(upper.z, 16); z++) { chunks.push_back(glm::ivec3(x, y, z)); }
+		}
+	}
+}
+
+void StructurePlacementTable::add(const glm::ivec3& chunk, const StructurePlacement& placement)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mChunks[chunk].push_back(placement);
+}
+
+std::vector<StructurePlacement> StructurePlacementTable::take(const glm::ivec3& chunk)
+{
+	std::vector<StructurePlacement> placements;
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto it = mChunks.find(chunk);
+	if (it == mChunks.end()) { return placements; }
+
+	placements.swap(it->second);
+	mChunks.erase(it);
+	std::sort(placements.begin(), placements.end());
+	return placements;
+}
+
+void StructurePlacementTable::clear()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mChunks.clear();
+}
+
+int StructurePlacementTable::getChunkCount()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return (int)mChunks.size();
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "VecUtil.h"
+
+// a voxel of a stamp, laid out like the voxels of a volume so runs of them can be copied into one as they are
+struct StampVoxel
+{
+	unsigned char r;
+	unsigned char g;
+	unsigned char b;
+	unsigned char a; // 0 is empty, whatever is in the world stays there
+};
+
+// a run of solid voxels along x
+struct StampSpan
+{
+	glm::ivec3 mStart; // relative to the stamp's origin
+	int mLength;
+	int mOffset; // of its first voxel in the stamp's voxels
+};
+
+// a structure (tree, wall, ...) built once and copied wherever it is placed. only the solid voxels are kept, packed into
+// runs along x, so placing it copies whole runs instead of setting voxels one by one
+class StructureStamp
+{
+public:
+	typedef std::function<void(const glm::ivec3& start, const StampVoxel* voxels, int count)> SpanCopy;
+
+private:
+	glm::ivec3 mLower; // bounds of the solid voxels relative to the origin, inclusive
+	glm::ivec3 mUpper;
+	std::vector<StampSpan> mSpans;
+	std::vector<StampVoxel> mVoxels;
+	unsigned int mBuildOrder; // stamps built later come later among placements with the same origin
+
+public:
+	// voxels is a dense box of size voxels with its lower corner at lower, x first, then y, then z
+	StructureStamp(const glm::ivec3& lower, const glm::ivec3& size, const std::vector<StampVoxel>& voxels);
+
+	const glm::ivec3& getLower() const { return mLower; }
+	const glm::ivec3& getUpper() const { return mUpper; }
+	int getSpanCount() const { return (int)mSpans.size(); }
+	int getVoxelCount() const { return (int)mVoxels.size(); }
+	unsigned int getBuildOrder() const { return mBuildOrder; }
+
+	// hands copy every run of the stamp placed at origin, clipped to the world box [lower, upper]
+	void forEachSpan(const glm::ivec3& origin, const glm::ivec3& lower, const glm::ivec3& upper, const SpanCopy& copy) const;
+};
+
+struct StructurePlacement
+{
+	const StructureStamp* mStamp;
+	glm::ivec3 mOrigin;
+
+	// by origin, then stamp. where placed structures overlap, the one last in this order wins
+	bool operator<(const StructurePlacement& other) const;
+};
+
+// hands copy the runs of a placement inside the world box [lower, upper] that no placement in placed after it covers. a
+// box that gets its structures in any order through this ends up the same as if they had been copied in order
+void forEachUncoveredSpan(const StructurePlacement& placement, const std::vector<StructurePlacement>& placed, const glm::ivec3& lower, const glm::ivec3& upper, const StructureStamp::SpanCopy& copy);
+
+// placed structures by the chunks they still have to be copied into. a chunk takes its placements when it is decorated,
+// so a structure reaching into chunks that don't exist yet is finished once they do. thread safe
+class StructurePlacementTable
+{
+private:
+	std::mutex mMutex;
+	std::unordered_map<glm::ivec3, std::vector<StructurePlacement>, KeyHash_GLMIVec3, KeyEqual_GLMIVec3> mChunks;
+
+public:
+	// the chunks a placement has voxels in
+	static void getChunks(const StructurePlacement& placement, std::vector<glm::ivec3>& chunks);
+
+	void add(const glm::ivec3& chunk, const StructurePlacement& placement);
+	// removes and returns everything waiting for the chunk, in order
+	std::vector<StructurePlacement> take(const glm::ivec3& chunk);
+	void clear();
+
+	int getChunkCount();
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
 
 struct KeyHash_GLMIVec2
 {
@@ -16,4 +17,23 @@ struct KeyEqual_GLMIVec2
 	{
 		return a.x == b.x && a.y == b.y;
 	}
-};
\ No newline at end of file
+};
+
+struct KeyHash_GLMIVec3
+{
+	size_t operator()(const glm::ivec3& k) const
+	{
+		return std::hash<int>()(k.x) ^ std::hash<int>()(k.y) ^ std::hash<int>()(k.z);
+	}
+};
+
+struct KeyEqual_GLMIVec3
+{
+	bool operator()(const glm::ivec3& a, const glm::ivec3& b) const
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+};
+
+// integer division rounding towards negative infinity
+inline int floorDiv(int v, int d) { return v >= 0 ? v / d : -((-v + d - 1) / d); }
\ No newline at end of file
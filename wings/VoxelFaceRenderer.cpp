@@ -0,0 +1,141 @@
+#include <cstdio>
+
+#include "VoxelFaceRenderer.h"
+
+#include <GL/glew.h>
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+
+// the corner table reproduces the vertex order and winding of extractVolumeSurface, relative to the face's voxel
+const char* voxelFaceVertexShader = R"(
+#version 430 compatibility
+
+layout(std430, binding = 0) readonly buffer ChunkFaces { uint words[]; };
+uniform uint paletteOffset;
+flat out vec4 faceColor;
+
+const vec3 corners[24] = vec3[24](
+	vec3(1, 0, 0), vec3(1, 0, 1), vec3(1, 1, 0), vec3(1, 1, 1),
+	vec3(1, 0, 0), vec3(1, 0, 1), vec3(1, 1, 0), vec3(1, 1, 1),
+	vec3(0, 1, 0), vec3(0, 1, 1), vec3(1, 1, 0), vec3(1, 1, 1),
+	vec3(0, 1, 0), vec3(0, 1, 1), vec3(1, 1, 0), vec3(1, 1, 1),
+	vec3(0, 0, 1), vec3(0, 1, 1), vec3(1, 0, 1), vec3(1, 1, 1),
+	vec3(0, 0, 1), vec3(0, 1, 1), vec3(1, 0, 1), vec3(1, 1, 1));
+
+const int frontIndices[6] = int[6](0, 2, 1, 1, 2, 3);
+const int backIndices[6] = int[6](0, 1, 2, 1, 3, 2);
+
+void main()
+{
+	uint word = words[gl_VertexID / 6];
+	uint face = (word >> 12) & 7u;
+	vec3 cell = vec3(word & 15u, (word >> 4) & 15u, (word >> 8) & 15u);
+
+	// +x, -y and +z faces use the first winding, the others the second
+	bool front = face == 0u || face == 3u || face == 4u;
+	int corner = front ? frontIndices[gl_VertexID % 6] : backIndices[gl_VertexID % 6];
+
+	uint rgb = words[paletteOffset + (word >> 15)];
+	faceColor = vec4(float(rgb & 255u), float((rgb >> 8) & 255u), float((rgb >> 16) & 255u), 255.0) / 255.0;
+	gl_Position = gl_ModelViewProjectionMatrix * vec4(cell + corners[face * 4u + uint(corner)], 1.0);
+}
+)";
+
+const char* voxelFaceFragmentShader = R"(
+#version 430 compatibility
+
+flat in vec4 faceColor;
+layout(location = 0) out vec4 fragColor;
+
+void main() { fragColor = faceColor; }
+)";
+
+GLuint voxelFaceProgram = 0;
+GLint voxelFacePaletteOffsetLocation = -1;
+
+PackedFaceMesh::~PackedFaceMesh()
+{
+	if (mBuffer != 0) { glDeleteBuffers(1, &mBuffer); }
+}
+
+GLuint compileVoxelFaceShader(GLenum type, const char* source)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, 0);
+	glCompileShader(shader);
+
+	GLint status = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (!status)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), 0, log);
+		printf("Voxel face shader failed to compile: %s\n", log);
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+bool VoxelFaceRenderer::init()
+{
+	if (!GLEW_VERSION_4_3) { printf("GL 4.3 is not available, using fixed function chunk rendering\n"); return false; }
+
+	GLuint vs = compileVoxelFaceShader(GL_VERTEX_SHADER, voxelFaceVertexShader);
+	GLuint fs = compileVoxelFaceShader(GL_FRAGMENT_SHADER, voxelFaceFragmentShader);
+	if (vs == 0 || fs == 0) { return false; }
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vs);
+	glAttachShader(program, fs);
+	glLinkProgram(program);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+
+	GLint status = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (!status)
+	{
+		char log[1024];
+		glGetProgramInfoLog(program, sizeof(log), 0, log);
+		printf("Voxel face shader failed to link: %s\n", log);
+		glDeleteProgram(program);
+		return false;
+	}
+
+	voxelFaceProgram = program;
+	voxelFacePaletteOffsetLocation = glGetUniformLocation(program, "paletteOffset");
+	printf("Using vertex pulling chunk rendering\n");
+	return true;
+}
+
+bool VoxelFaceRenderer::isEnabled() { return voxelFaceProgram != 0; }
+
+void VoxelFaceRenderer::begin() { glUseProgram(voxelFaceProgram); }
+
+void VoxelFaceRenderer::end() { glUseProgram(0); }
+
+void VoxelFaceRenderer::upload(PackedFaceMesh* mesh)
+{
+	if (mesh->mWords.empty()) { return; }
+
+	if (mesh->mBuffer == 0) { glGenBuffers(1, &mesh->mBuffer); }
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mesh->mBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, mesh->mWords.size() * sizeof(unsigned int), &mesh->mWords[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// the gpu copy is all that's needed from here on
+	std::vector<unsigned int>().swap(mesh->mWords);
+}
+
+void VoxelFaceRenderer::draw(const PackedFaceMesh* mesh)
+{
+	if (mesh->mBuffer == 0 || mesh->mFaceCount == 0) { return; }
+
+	glUniform1ui(voxelFacePaletteOffsetLocation, (GLuint)mesh->mFaceCount);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mesh->mBuffer);
+	glDrawArrays(GL_TRIANGLES, 0, mesh->mFaceCount * 6);
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+// chunk surface stored as one 32 bit word per face (local xyz, face direction, palette index) followed by the
+// chunk's rgb palette. faces are expanded to quads in the vertex shader, so a face costs 4 bytes instead of 4 vertices
+struct PackedFaceMesh
+{
+	std::vector<unsigned int> mWords;
+	int mFaceCount = 0;
+	unsigned int mBuffer = 0;
+
+	~PackedFaceMesh();
+};
+
+// face directions, the odd ones belong to the voxel on the positive side of the face plane
+enum VoxelFace
+{
+	FACE_POSITIVE_X,
+	FACE_NEGATIVE_X,
+	FACE_POSITIVE_Y,
+	FACE_NEGATIVE_Y,
+	FACE_POSITIVE_Z,
+	FACE_NEGATIVE_Z
+};
+
+// optional gl 4.3 vertex pulling path for voxel chunks. the fixed function path stays the fallback
+class VoxelFaceRenderer
+{
+private:
+	VoxelFaceRenderer() {}
+
+public:
+	static unsigned int packFace(int x, int y, int z, VoxelFace face, unsigned int paletteIndex) { return (x & 15) | ((y & 15) << 4) | ((z & 15) << 8) | (face << 12) | (paletteIndex << 15); }
+	static unsigned int packColor(unsigned char r, unsigned char g, unsigned char b) { return r | (g << 8) | (b << 16); }
+
+	// compiles the shader, returns false if the context can't run it
+	static bool init();
+	static bool isEnabled();
+
+	static void begin();
+	static void end();
+	static void upload(PackedFaceMesh* mesh);
+	static void draw(const PackedFaceMesh* mesh);
+};
\ No newline at end of file